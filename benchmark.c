@@ -0,0 +1,991 @@
+/***************************************************************************
+*               Benchmark Program for LZW Encoding Library
+*
+*   File    : benchmark.c
+*   Purpose : Time LZW encoding and decoding of generated data sets,
+*             including inputs that are adversarial for tree based
+*             dictionaries (monotonic counters, sorted keys, runs).  With
+*             -c, check that the memory and piece by piece interfaces
+*             produce the same results as the file interface instead.
+*   Author  : agent
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* BENCHMARK: Timing of the Lempel-Ziv-Welch Encoding Library
+* Copyright (C) 2026 by
+* agent (agent@local)
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include "optlist/optlist.h"
+#include "lzw.h"
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* function that writes size bytes of generated data to a file */
+typedef void (*generator_t)(FILE *fp, const long size);
+
+typedef struct
+{
+    const char *name;           /* name of data set */
+    generator_t generator;      /* function that generates the data set */
+} data_set_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+static void MakeCounters(FILE *fp, const long size);
+static void MakeSortedKeys(FILE *fp, const long size);
+static void MakeZeros(FILE *fp, const long size);
+static void MakeRamp(FILE *fp, const long size);
+static void MakeRandom(FILE *fp, const long size);
+
+static int RunDataSet(const data_set_t *dataSet, const long size);
+static int TimeDataSet(const data_set_t *dataSet, const long size,
+    FILE *fpData, FILE *fpEncoded, FILE *fpDecoded);
+static double Seconds(const clock_t start, const clock_t end);
+
+static int CheckDataSet(const data_set_t *dataSet, const long size);
+static int CheckSettings(lzw_encoder_t *encoder, lzw_decoder_t *decoder,
+    const unsigned char *data, const size_t dataSize);
+static int CheckPushed(lzw_encoder_t *encoder, const unsigned char *data,
+    const size_t dataSize, const unsigned char *encoded,
+    const size_t encodedSize, const size_t maxPiece);
+static int CheckFed(lzw_decoder_t *decoder, const unsigned char *encoded,
+    const size_t encodedSize, const unsigned char *data,
+    const size_t dataSize, const size_t maxPiece);
+static unsigned char *ReadAll(FILE *fp, size_t *size);
+static size_t PieceSize(const size_t maxPiece);
+static int Failed(const char *what);
+
+/***************************************************************************
+*                            GLOBAL VARIABLES
+***************************************************************************/
+static const data_set_t dataSets[] =
+{
+    {"counters", MakeCounters},     /* "1\n2\n3\n..." */
+    {"sorted-keys", MakeSortedKeys},/* sorted CSV keys */
+    {"zeros", MakeZeros},           /* one long run */
+    {"ramp", MakeRamp},             /* 0x00, 0x01, ... 0xFF, 0x00, ... */
+    {"random", MakeRandom},         /* incompressible */
+    {NULL, NULL}
+};
+
+/* settings every data set is checked with */
+static const unsigned int checkCodeLens[] =
+    {LZW_MIN_CODE_LEN, 12, LZW_DEFAULT_CODE_LEN, 0};
+
+static const lzw_full_policy_t checkPolicies[] =
+    {LZW_FULL_RESET, LZW_FULL_LRU, LZW_FULL_STANDBY, LZW_FULL_FREEZE};
+
+static const char *policyNames[] = {"reset", "lru", "standby", "freeze"};
+
+static const unsigned int checkThresholds[] = {0, 60};
+
+#define NUM_POLICIES    (sizeof(checkPolicies) / sizeof(checkPolicies[0]))
+#define NUM_THRESHOLDS  (sizeof(checkThresholds) / sizeof(checkThresholds[0]))
+
+/* largest piece used when pieces are random sizes */
+#define MAX_PIECE       4096
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/****************************************************************************
+*   Function   : main
+*   Description: This is the main function for this program.  It generates
+*                each data set, then times encoding and decoding it, or
+*                checks every interface against the file interface.
+*   Parameters : argc - number of parameters
+*                argv - parameter list
+*   Effects    : Writes a table of timings to stdout
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+int main(int argc, char *argv[])
+{
+    option_t *optList;
+    option_t *thisOpt;
+    long size;              /* bytes in each data set */
+    int check;              /* check interfaces instead of timing */
+    int i;
+
+    size = 1L << 20;
+    check = 0;
+
+    /* parse command line */
+    optList = GetOptList(argc, argv, "cs:h?");
+    thisOpt = optList;
+
+    while (thisOpt != NULL)
+    {
+        switch(thisOpt->option)
+        {
+            case 'c':       /* check interfaces */
+                check = 1;
+                break;
+
+            case 's':       /* data set size */
+                size = atol(thisOpt->argument);
+
+                if (size <= 0)
+                {
+                    fprintf(stderr, "Invalid data set size.\n");
+                    FreeOptList(optList);
+                    errno = EINVAL;
+                    return -1;
+                }
+                break;
+
+            case 'h':
+            case '?':
+                printf("Usage: %s <options>\n\n", FindFileName(argv[0]));
+                printf("options:\n");
+                printf("  -c : Check the memory and piece interfaces ");
+                printf("against the file\n       interfaces.\n");
+                printf("  -s <bytes> : Size of each data set.\n");
+                printf("  -h | ?  : Print out command line options.\n\n");
+                printf("Default: %s -s %ld\n", FindFileName(argv[0]), size);
+
+                FreeOptList(optList);
+                return 0;
+        }
+
+        optList = thisOpt->next;
+        free(thisOpt);
+        thisOpt = optList;
+    }
+
+    if (check)
+    {
+        /* same pieces every run, so failures can be repeated */
+        srand(1);
+        printf("%-12s %10s %10s\n", "data set", "bytes", "settings");
+    }
+    else
+    {
+        printf("%-12s %10s %10s %10s %10s %10s\n", "data set", "bytes",
+            "encoded", "enc sec", "dec sec", "enc MB/s");
+    }
+
+    for (i = 0; dataSets[i].name != NULL; i++)
+    {
+        if (check)
+        {
+            if (0 != CheckDataSet(&dataSets[i], size))
+            {
+                perror(dataSets[i].name);
+                return -1;
+            }
+        }
+        else if (0 != RunDataSet(&dataSets[i], size))
+        {
+            perror(dataSets[i].name);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : RunDataSet
+*   Description: This function creates the temporary files used to time a
+*                data set, runs it, and cleans up.
+*   Parameters : dataSet - data set to run
+*                size - number of bytes in the data set
+*   Effects    : Writes a line of timings to stdout
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int RunDataSet(const data_set_t *dataSet, const long size)
+{
+    FILE *fpData, *fpEncoded, *fpDecoded;
+    int result;
+
+    fpData = tmpfile();
+    fpEncoded = tmpfile();
+    fpDecoded = tmpfile();
+
+    if ((NULL == fpData) || (NULL == fpEncoded) || (NULL == fpDecoded))
+    {
+        result = -1;
+    }
+    else
+    {
+        result = TimeDataSet(dataSet, size, fpData, fpEncoded, fpDecoded);
+    }
+
+    if (NULL != fpData)
+    {
+        fclose(fpData);
+    }
+
+    if (NULL != fpEncoded)
+    {
+        fclose(fpEncoded);
+    }
+
+    if (NULL != fpDecoded)
+    {
+        fclose(fpDecoded);
+    }
+
+    return result;
+}
+
+/****************************************************************************
+*   Function   : TimeDataSet
+*   Description: This function generates a data set, encodes and decodes
+*                it, verifies the result, and prints the time spent on each
+*                step.
+*   Parameters : dataSet - data set to run
+*                size - minimum number of bytes in the data set
+*                fpData - empty file for the data set
+*                fpEncoded - empty file for the encoded data set
+*                fpDecoded - empty file for the decoded data set
+*   Effects    : Writes a line of timings to stdout
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int TimeDataSet(const data_set_t *dataSet, const long size,
+    FILE *fpData, FILE *fpEncoded, FILE *fpDecoded)
+{
+    clock_t start, encoded, decoded;
+    long dataSize, encodedSize;
+    int c;
+
+    dataSet->generator(fpData, size);
+    dataSize = ftell(fpData);
+    rewind(fpData);
+
+    start = clock();
+
+    if (0 != LZWEncodeFile(fpData, fpEncoded))
+    {
+        return -1;
+    }
+
+    fflush(fpEncoded);
+    encoded = clock();
+    encodedSize = ftell(fpEncoded);
+    rewind(fpEncoded);
+
+    if (0 != LZWDecodeFile(fpEncoded, fpDecoded))
+    {
+        return -1;
+    }
+
+    fflush(fpDecoded);
+    decoded = clock();
+
+    /* make sure the round trip worked */
+    rewind(fpData);
+    rewind(fpDecoded);
+
+    while ((c = fgetc(fpData)) != EOF)
+    {
+        if (c != fgetc(fpDecoded))
+        {
+            break;
+        }
+    }
+
+    if ((EOF != c) || (EOF != fgetc(fpDecoded)))
+    {
+        fprintf(stderr, "%s: decoded data does not match\n", dataSet->name);
+        errno = EILSEQ;
+        return -1;
+    }
+
+    printf("%-12s %10ld %10ld %10.3f %10.3f %10.2f\n", dataSet->name,
+        dataSize, encodedSize, Seconds(start, encoded),
+        Seconds(encoded, decoded),
+        (dataSize / 1048576.0) / Seconds(start, encoded));
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : Seconds
+*   Description: This function converts an interval measured with clock()
+*                into seconds.  Intervals too short to measure are
+*                reported as one clock tick so rates remain finite.
+*   Parameters : start - clock() at the start of the interval
+*                end - clock() at the end of the interval
+*   Effects    : None
+*   Returned   : Length of the interval in seconds
+****************************************************************************/
+static double Seconds(const clock_t start, const clock_t end)
+{
+    if (end <= start)
+    {
+        return 1.0 / CLOCKS_PER_SEC;
+    }
+
+    return (double)(end - start) / CLOCKS_PER_SEC;
+}
+
+/****************************************************************************
+*   Function   : CheckDataSet
+*   Description: This function generates a data set and checks it with the
+*                default encoder and decoder, then with every combination
+*                of code word length, full dictionary policy, and reset
+*                threshold in the check tables.
+*   Parameters : dataSet - data set to check
+*                size - minimum number of bytes in the data set
+*   Effects    : Writes the number of settings checked to stdout, or what
+*                failed to stderr
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int CheckDataSet(const data_set_t *dataSet, const long size)
+{
+    FILE *fpData;
+    unsigned char *data;
+    size_t dataSize;
+    lzw_encoder_t *encoder;
+    lzw_decoder_t *decoder;
+    unsigned int len, policy, threshold;
+    unsigned int checked;
+    int result;
+
+    fpData = tmpfile();
+
+    if (NULL == fpData)
+    {
+        return -1;
+    }
+
+    dataSet->generator(fpData, size);
+    data = ReadAll(fpData, &dataSize);
+    fclose(fpData);
+
+    if (NULL == data)
+    {
+        return -1;
+    }
+
+    /* LZWEncodeBuffer, LZWDecodeBuffer, ... */
+    result = CheckSettings(NULL, NULL, data, dataSize);
+    checked = 1;
+
+    if (0 != result)
+    {
+        fprintf(stderr, "%s: default settings\n", dataSet->name);
+        free(data);
+        return result;
+    }
+
+    decoder = LZWCreateDecoder();
+
+    if (NULL == decoder)
+    {
+        free(data);
+        return -1;
+    }
+
+    for (len = 0; (0 == result) && (0 != checkCodeLens[len]); len++)
+    {
+        encoder = LZWCreateEncoder(checkCodeLens[len]);
+
+        if (NULL == encoder)
+        {
+            result = -1;
+            break;
+        }
+
+        for (policy = 0; (0 == result) && (policy < NUM_POLICIES); policy++)
+        {
+            for (threshold = 0;
+                (0 == result) && (threshold < NUM_THRESHOLDS);
+                threshold++)
+            {
+                result = LZWEncoderSetFullPolicy(encoder,
+                    checkPolicies[policy]);
+
+                if (0 == result)
+                {
+                    result = LZWEncoderSetResetThreshold(encoder,
+                        checkThresholds[threshold]);
+                }
+
+                if (0 == result)
+                {
+                    result = CheckSettings(encoder, decoder, data, dataSize);
+                }
+
+                if (0 != result)
+                {
+                    fprintf(stderr, "%s: -b %u -f %s -r %u\n", dataSet->name,
+                        checkCodeLens[len], policyNames[policy],
+                        checkThresholds[threshold]);
+                }
+
+                checked++;
+            }
+        }
+
+        LZWDestroyEncoder(encoder);
+    }
+
+    LZWDestroyDecoder(decoder);
+
+    if (0 == result)
+    {
+        printf("%-12s %10lu %10u\n", dataSet->name, (unsigned long)dataSize,
+            checked);
+    }
+
+    free(data);
+    return result;
+}
+
+/****************************************************************************
+*   Function   : CheckSettings
+*   Description: This function encodes and decodes data with the file
+*                interface, then checks that the memory and piece by piece
+*                interfaces produce the same results.  It also checks
+*                that LZWCompressBound is large enough and that output
+*                buffers that are one byte short fail with ENOBUFS.
+*   Parameters : encoder - encoder to check, NULL for LZWEncodeFile and
+*                          LZWEncodeBuffer (pushed pieces are skipped)
+*                decoder - decoder to check, NULL for LZWDecodeFile and
+*                          LZWDecodeBuffer (fed pieces are skipped)
+*                data - data to encode
+*                dataSize - number of bytes in data
+*   Effects    : Writes what failed to stderr
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int CheckSettings(lzw_encoder_t *encoder, lzw_decoder_t *decoder,
+    const unsigned char *data, const size_t dataSize)
+{
+    FILE *fpData, *fpEncoded, *fpDecoded;
+    unsigned char *encoded, *decoded, *buffer;
+    size_t encodedSize, decodedSize, bound, outLen;
+    size_t caps[3];
+    int i, status, result;
+
+    encoded = NULL;
+    decoded = NULL;
+    buffer = NULL;
+    fpData = tmpfile();
+    fpEncoded = tmpfile();
+    fpDecoded = tmpfile();
+    result = 0;
+
+    if ((NULL == fpData) || (NULL == fpEncoded) || (NULL == fpDecoded) ||
+        (dataSize != fwrite(data, 1, dataSize, fpData)))
+    {
+        result = -1;
+    }
+
+    /* the file interface is the reference */
+    if (0 == result)
+    {
+        rewind(fpData);
+        status = (NULL == encoder) ? LZWEncodeFile(fpData, fpEncoded) :
+            LZWEncoderEncodeFile(encoder, fpData, fpEncoded);
+
+        if (0 == status)
+        {
+            encoded = ReadAll(fpEncoded, &encodedSize);
+        }
+
+        if (NULL == encoded)
+        {
+            result = Failed("file encoding failed");
+        }
+    }
+
+    if (0 == result)
+    {
+        rewind(fpEncoded);
+        status = (NULL == decoder) ? LZWDecodeFile(fpEncoded, fpDecoded) :
+            LZWDecoderDecodeFile(decoder, fpEncoded, fpDecoded);
+
+        if (0 == status)
+        {
+            decoded = ReadAll(fpDecoded, &decodedSize);
+        }
+
+        if ((NULL == decoded) || (decodedSize != dataSize) ||
+            (0 != memcmp(decoded, data, dataSize)))
+        {
+            result = Failed("file decoding doesn't match the data");
+        }
+    }
+
+    /* buffers: large enough, exact, and one byte short */
+    if (0 == result)
+    {
+        bound = LZWCompressBound(dataSize);
+
+        if (encodedSize > bound)
+        {
+            result = Failed("encoded data is larger than LZWCompressBound");
+        }
+        else
+        {
+            buffer = (unsigned char *)malloc(
+                ((bound > dataSize) ? bound : dataSize) + 1);
+
+            if (NULL == buffer)
+            {
+                result = -1;
+            }
+        }
+    }
+
+    if (0 == result)
+    {
+        caps[0] = bound;
+        caps[1] = encodedSize;
+        caps[2] = encodedSize - 1;      /* there's always a header */
+
+        for (i = 0; (0 == result) && (i < 3); i++)
+        {
+            status = (NULL == encoder) ?
+                LZWEncodeBuffer(data, dataSize, buffer, caps[i], &outLen) :
+                LZWEncoderEncodeBuffer(encoder, data, dataSize, buffer,
+                    caps[i], &outLen);
+
+            if (caps[i] < encodedSize)
+            {
+                if ((-1 != status) || (ENOBUFS != errno))
+                {
+                    result = Failed("short encode buffer isn't ENOBUFS");
+                }
+            }
+            else if ((0 != status) || (outLen != encodedSize) ||
+                (0 != memcmp(buffer, encoded, encodedSize)))
+            {
+                result = Failed("buffer encoding doesn't match the file");
+            }
+        }
+    }
+
+    if (0 == result)
+    {
+        caps[0] = dataSize + 1;
+        caps[1] = dataSize - 1;         /* data sets aren't empty */
+        caps[2] = dataSize;
+
+        for (i = 0; (0 == result) && (i < 3); i++)
+        {
+            status = (NULL == decoder) ?
+                LZWDecodeBuffer(encoded, encodedSize, buffer, caps[i],
+                    &outLen) :
+                LZWDecoderDecodeBuffer(decoder, encoded, encodedSize, buffer,
+                    caps[i], &outLen);
+
+            if (caps[i] < dataSize)
+            {
+                if ((-1 != status) || (ENOBUFS != errno))
+                {
+                    result = Failed("short decode buffer isn't ENOBUFS");
+                }
+            }
+            else if ((0 != status) || (outLen != dataSize) ||
+                (0 != memcmp(buffer, data, dataSize)))
+            {
+                result = Failed("buffer decoding doesn't match the data");
+            }
+        }
+    }
+
+    /* pieces, one byte at a time and random sizes */
+    if ((0 == result) && (NULL != encoder))
+    {
+        if (0 != CheckPushed(encoder, data, dataSize, encoded, encodedSize,
+            1))
+        {
+            result = Failed("1 byte pushed pieces don't match the file");
+        }
+        else if (0 != CheckPushed(encoder, data, dataSize, encoded,
+            encodedSize, MAX_PIECE))
+        {
+            result = Failed("random pushed pieces don't match the file");
+        }
+    }
+
+    if ((0 == result) && (NULL != decoder))
+    {
+        /* memory decoded to is freed, the next piece starts a new stream */
+        free(buffer);
+        buffer = NULL;
+
+        if (0 != CheckFed(decoder, encoded, encodedSize, data, dataSize, 1))
+        {
+            result = Failed("1 byte fed pieces don't match the data");
+        }
+        else if ((0 != LZWDecoderStart(decoder)) ||
+            (0 != CheckFed(decoder, encoded, encodedSize, data, dataSize,
+            MAX_PIECE)))
+        {
+            result = Failed("random fed pieces don't match the data");
+        }
+    }
+
+    free(buffer);
+    free(decoded);
+    free(encoded);
+
+    if (NULL != fpData)
+    {
+        fclose(fpData);
+    }
+
+    if (NULL != fpEncoded)
+    {
+        fclose(fpEncoded);
+    }
+
+    if (NULL != fpDecoded)
+    {
+        fclose(fpDecoded);
+    }
+
+    return result;
+}
+
+/****************************************************************************
+*   Function   : CheckPushed
+*   Description: This function pushes data to an encoder in pieces, with
+*                an occasional flush between them, and compares the result
+*                to data encoded in one shot.
+*   Parameters : encoder - encoder to push data to
+*                data - data to encode
+*                dataSize - number of bytes in data
+*                encoded - data encoded in one shot
+*                encodedSize - number of bytes in encoded
+*                maxPiece - largest piece to push
+*   Effects    : None
+*   Returned   : 0 if the pushed pieces encode to the same data, otherwise
+*                -1.
+****************************************************************************/
+static int CheckPushed(lzw_encoder_t *encoder, const unsigned char *data,
+    const size_t dataSize, const unsigned char *encoded,
+    const size_t encodedSize, const size_t maxPiece)
+{
+    FILE *fpOut;
+    unsigned char *pushed;
+    size_t pushedSize, next, piece;
+    int result;
+
+    fpOut = tmpfile();
+
+    if (NULL == fpOut)
+    {
+        return -1;
+    }
+
+    result = LZWEncoderStart(encoder, fpOut);
+
+    for (next = 0; (0 == result) && (next < dataSize); next += piece)
+    {
+        piece = PieceSize(maxPiece);
+
+        if (piece > (dataSize - next))
+        {
+            piece = dataSize - next;
+        }
+
+        result = LZWEncoderUpdate(encoder, data + next, piece);
+
+        if ((0 == result) && (0 == (rand() % 16)))
+        {
+            result = LZWEncoderFlush(encoder);
+        }
+    }
+
+    /* always finish, so the encoder can be set up for the next check */
+    if ((0 != LZWEncoderFinish(encoder)) || (0 != result))
+    {
+        fclose(fpOut);
+        return -1;
+    }
+
+    pushed = ReadAll(fpOut, &pushedSize);
+    fclose(fpOut);
+
+    if (NULL == pushed)
+    {
+        return -1;
+    }
+
+    if ((pushedSize != encodedSize) ||
+        (0 != memcmp(pushed, encoded, encodedSize)))
+    {
+        result = -1;
+    }
+
+    free(pushed);
+    return result;
+}
+
+/****************************************************************************
+*   Function   : CheckFed
+*   Description: This function feeds encoded data to a decoder in pieces,
+*                draining it into pieces of random size between them, and
+*                compares the decoded data to the original data.
+*   Parameters : decoder - decoder to feed, ready for a new stream
+*                encoded - encoded data
+*                encodedSize - number of bytes in encoded
+*                data - data that was encoded
+*                dataSize - number of bytes in data
+*                maxPiece - largest piece to feed or drain
+*   Effects    : None
+*   Returned   : 0 if the fed pieces decode to the original data,
+*                otherwise -1.
+****************************************************************************/
+static int CheckFed(lzw_decoder_t *decoder, const unsigned char *encoded,
+    const size_t encodedSize, const unsigned char *data,
+    const size_t dataSize, const size_t maxPiece)
+{
+    unsigned char out[MAX_PIECE];
+    size_t next, piece, used, drained, outCap, outLen;
+
+    next = 0;
+    drained = 0;
+
+    while (next < encodedSize)
+    {
+        piece = PieceSize(maxPiece);
+
+        if (piece > (encodedSize - next))
+        {
+            piece = encodedSize - next;
+        }
+
+        if (0 != LZWDecoderFeed(decoder, encoded + next, piece, &used))
+        {
+            return -1;
+        }
+
+        next += used;
+
+        /* drain until the decoder has nothing left for this piece */
+        do
+        {
+            outCap = PieceSize(maxPiece);
+
+            if (0 != LZWDecoderDrain(decoder, out, outCap, &outLen))
+            {
+                return -1;
+            }
+
+            if ((outLen > (dataSize - drained)) ||
+                (0 != memcmp(out, data + drained, outLen)))
+            {
+                return -1;
+            }
+
+            drained += outLen;
+        } while (outLen == outCap);
+    }
+
+    return (drained == dataSize) ? 0 : -1;
+}
+
+/****************************************************************************
+*   Function   : ReadAll
+*   Description: This function reads the whole of a file into memory.
+*   Parameters : fp - file to read
+*                size - set to the number of bytes read
+*   Effects    : fp is read from its start to its end
+*   Returned   : Allocated copy of the file's contents (free it when done),
+*                or NULL for failure.
+****************************************************************************/
+static unsigned char *ReadAll(FILE *fp, size_t *size)
+{
+    unsigned char *contents;
+    long length;
+
+    if ((0 != fseek(fp, 0, SEEK_END)) || ((length = ftell(fp)) < 0))
+    {
+        return NULL;
+    }
+
+    rewind(fp);
+    contents = (unsigned char *)malloc((size_t)length + 1);
+
+    if (NULL == contents)
+    {
+        return NULL;
+    }
+
+    *size = fread(contents, 1, (size_t)length, fp);
+
+    if (*size != (size_t)length)
+    {
+        free(contents);
+        return NULL;
+    }
+
+    return contents;
+}
+
+/****************************************************************************
+*   Function   : PieceSize
+*   Description: This function picks the size of the next piece to push,
+*                feed, or drain.  Half of the random sizes are small, so
+*                pieces often end in the middle of a string.
+*   Parameters : maxPiece - largest piece, 1 for one byte pieces
+*   Effects    : Advances rand()
+*   Returned   : Number of bytes in the next piece
+****************************************************************************/
+static size_t PieceSize(const size_t maxPiece)
+{
+    if (maxPiece <= 1)
+    {
+        return 1;
+    }
+
+    if (0 == (rand() % 2))
+    {
+        return 1 + (size_t)(rand() % 16);
+    }
+
+    return 1 + (size_t)rand() % maxPiece;
+}
+
+/****************************************************************************
+*   Function   : Failed
+*   Description: This function reports a failed check.
+*   Parameters : what - description of the check that failed
+*   Effects    : Writes what to stderr and sets errno to EILSEQ
+*   Returned   : -1
+****************************************************************************/
+static int Failed(const char *what)
+{
+    fprintf(stderr, "%s\n", what);
+    errno = EILSEQ;
+    return -1;
+}
+
+/****************************************************************************
+*   Function   : MakeCounters
+*   Description: This function writes a monotonic series of decimal
+*                counters, one per line.
+*   Parameters : fp - file to write to
+*                size - number of bytes to write
+*   Effects    : size bytes are written to fp
+*   Returned   : None
+****************************************************************************/
+static void MakeCounters(FILE *fp, const long size)
+{
+    unsigned long counter;
+    long written;
+
+    for (counter = 1, written = 0; written < size; counter++)
+    {
+        written += fprintf(fp, "%lu\n", counter);
+    }
+}
+
+/****************************************************************************
+*   Function   : MakeSortedKeys
+*   Description: This function writes CSV records with sorted, fixed width
+*                keys.
+*   Parameters : fp - file to write to
+*                size - number of bytes to write
+*   Effects    : size bytes are written to fp
+*   Returned   : None
+****************************************************************************/
+static void MakeSortedKeys(FILE *fp, const long size)
+{
+    unsigned long key;
+    long written;
+
+    for (key = 0, written = 0; written < size; key++)
+    {
+        written += fprintf(fp, "key%08lu,%lu,value\n", key, (key * 7) % 1000);
+    }
+}
+
+/****************************************************************************
+*   Function   : MakeZeros
+*   Description: This function writes a run of zero bytes.
+*   Parameters : fp - file to write to
+*                size - number of bytes to write
+*   Effects    : size bytes are written to fp
+*   Returned   : None
+****************************************************************************/
+static void MakeZeros(FILE *fp, const long size)
+{
+    long i;
+
+    for (i = 0; i < size; i++)
+    {
+        fputc(0, fp);
+    }
+}
+
+/****************************************************************************
+*   Function   : MakeRamp
+*   Description: This function writes repeating ascending byte values.
+*   Parameters : fp - file to write to
+*                size - number of bytes to write
+*   Effects    : size bytes are written to fp
+*   Returned   : None
+****************************************************************************/
+static void MakeRamp(FILE *fp, const long size)
+{
+    long i;
+
+    for (i = 0; i < size; i++)
+    {
+        fputc((int)(i & 0xFF), fp);
+    }
+}
+
+/****************************************************************************
+*   Function   : MakeRandom
+*   Description: This function writes pseudo-random bytes from a linear
+*                congruential generator, so every run gets the same data.
+*   Parameters : fp - file to write to
+*                size - number of bytes to write
+*   Effects    : size bytes are written to fp
+*   Returned   : None
+****************************************************************************/
+static void MakeRandom(FILE *fp, const long size)
+{
+    unsigned long seed;
+    long i;
+
+    seed = 12345;
+
+    for (i = 0; i < size; i++)
+    {
+        seed = (seed * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+        fputc((int)((seed >> 16) & 0xFF), fp);
+    }
+}
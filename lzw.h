@@ -33,17 +33,96 @@
 #ifndef _LZW_H_
 #define _LZW_H_
 
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+struct lzw_encoder_t;
+
+/* encoder context; one may be reused to encode any number of files */
+typedef struct lzw_encoder_t lzw_encoder_t;
+
+struct lzw_decoder_t;
+
+/* decoder context; one may be reused to decode any number of files */
+typedef struct lzw_decoder_t lzw_decoder_t;
+
+/* what the encoder does when every code word has been assigned */
+typedef enum
+{
+    LZW_FULL_RESET = 0,     /* write a clear code and empty the dictionary */
+    LZW_FULL_LRU = 1,       /* reassign the least recently used code word */
+    LZW_FULL_STANDBY = 2,   /* switch to a dictionary of recent strings */
+    LZW_FULL_FREEZE = 3     /* stop adding strings until a clear */
+} lzw_full_policy_t;
+
 /***************************************************************************
 *                                CONSTANTS
 ***************************************************************************/
+#define LZW_MIN_CODE_LEN        9   /* shortest code words */
+#define LZW_MAX_CODE_LEN        24  /* largest maximum code word length */
+#define LZW_DEFAULT_CODE_LEN    20  /* maximum code word length if unset */
 
 /***************************************************************************
 *                               PROTOTYPES
 ***************************************************************************/
+
+#if defined __cplusplus
+extern "C"
+{
+#endif
+
  /* encode inFile */
 int LZWEncodeFile(FILE *fpIn, FILE *fpOut);
 
+/* create/destroy a reusable encoder, and encode inFile with it */
+lzw_encoder_t *LZWCreateEncoder(const unsigned int maxCodeLen);
+void LZWDestroyEncoder(lzw_encoder_t *encoder);
+int LZWEncoderEncodeFile(lzw_encoder_t *encoder, FILE *fpIn, FILE *fpOut);
+
+/* reset dictionary when output exceeds threshold % of input (0 = never) */
+int LZWEncoderSetResetThreshold(lzw_encoder_t *encoder,
+    const unsigned int threshold);
+
+/* choose what happens when the dictionary is full */
+int LZWEncoderSetFullPolicy(lzw_encoder_t *encoder,
+    const lzw_full_policy_t policy);
+
+/* encode in memory, LZWCompressBound(inLen) bytes of out is always enough */
+int LZWEncodeBuffer(const void *in, size_t inLen, void *out, size_t outCap,
+    size_t *outLen);
+int LZWEncoderEncodeBuffer(lzw_encoder_t *encoder, const void *in,
+    size_t inLen, void *out, size_t outCap, size_t *outLen);
+size_t LZWCompressBound(size_t inLen);
+
+/* encode a stream pushed to the encoder in pieces */
+int LZWEncoderStart(lzw_encoder_t *encoder, FILE *fpOut);
+int LZWEncoderUpdate(lzw_encoder_t *encoder, const void *in, size_t inLen);
+int LZWEncoderFlush(lzw_encoder_t *encoder);
+int LZWEncoderFinish(lzw_encoder_t *encoder);
+
 /* decode inFile*/
 int LZWDecodeFile(FILE *fpIn, FILE *fpOut);
 
+/* create/destroy a reusable decoder, and decode inFile with it */
+lzw_decoder_t *LZWCreateDecoder(void);
+void LZWDestroyDecoder(lzw_decoder_t *decoder);
+int LZWDecoderDecodeFile(lzw_decoder_t *decoder, FILE *fpIn, FILE *fpOut);
+
+/* decode in memory, out must be large enough for all of the decoded data */
+int LZWDecodeBuffer(const void *in, size_t inLen, void *out, size_t outCap,
+    size_t *outLen);
+int LZWDecoderDecodeBuffer(lzw_decoder_t *decoder, const void *in,
+    size_t inLen, void *out, size_t outCap, size_t *outLen);
+
+/* decode a stream fed in pieces, taking decoded data as it's ready */
+int LZWDecoderStart(lzw_decoder_t *decoder);
+int LZWDecoderFeed(lzw_decoder_t *decoder, const void *in, size_t inLen,
+    size_t *inUsed);
+int LZWDecoderDrain(lzw_decoder_t *decoder, void *out, size_t outCap,
+    size_t *outLen);
+
+#if defined __cplusplus
+}
+#endif
+
 #endif  /* ndef _LZW_H_ */
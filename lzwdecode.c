@@ -34,112 +34,811 @@
 *                             INCLUDED FILES
 ***************************************************************************/
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include "lzw.h"
 #include "lzwlocal.h"
-#include "bitfile/bitfile.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define OUTPUT_BLOCK    65536   /* decoded bytes written per fwrite */
+#define HISTORY_SIZE    262144  /* decoded bytes kept to copy strings from */
+#define FED_BLOCK       4096    /* decoded bytes waiting to be drained */
+#define FED_HISTORY     16384   /* decoded bytes kept by a fed decoder */
+#define INLINE_SIZE     8       /* longest string kept in its entry */
+#define INPUT_BLOCK     16384   /* encoded bytes read per fread */
+#define CODE_BATCH      512     /* most code words unpacked at once */
+
+/***************************************************************************
+* Output positions are unsigned longs, which may only be 32 bits, so they
+* wrap after 4 GiB of output.  Distances back from the current position are
+* taken modulo the type, which is right as long as no offset falls 4 GiB
+* behind.  Every SWEEP_INTERVAL bytes of output, string offsets more than
+* SWEEP_INTERVAL behind are moved to FAR_DISTANCE behind, which is too far
+* to be copied from.  Between sweeps no offset gets more than
+* FAR_DISTANCE + SWEEP_INTERVAL behind, so it can't look recent again.
+***************************************************************************/
+#define SWEEP_INTERVAL  0x40000000UL
+#define FAR_DISTANCE    0x80000000UL
 
 /***************************************************************************
 *                            TYPE DEFINITIONS
 ***************************************************************************/
 typedef struct
 {
-    unsigned char suffixChar;   /* last char in encoded string */
     unsigned int prefixCode;    /* code for remaining chars in string */
+    unsigned int length;        /* number of chars in string */
+    union
+    {
+        unsigned char chars[INLINE_SIZE];   /* length <= INLINE_SIZE */
+        unsigned long offset;   /* longer, output position of newest copy */
+    } string;
+    unsigned char suffixChar;   /* last char in encoded string */
+    unsigned char firstChar;    /* first char in encoded string */
 } decode_dictionary_t;
 
+/* what the decoder expects next */
+typedef enum
+{
+    DECODE_HEADER,              /* the stream's header byte */
+    DECODE_FIRST,               /* a character that starts a dictionary */
+    DECODE_CODES,               /* any code word */
+    DECODE_CLEARED,             /* the code word after a clear code */
+    DECODE_SWITCHED,            /* the first code word in a dictionary that
+                                   was switched to */
+    DECODE_CORRUPT              /* nothing, a code word couldn't have been
+                                   written by the encoder */
+} decode_state_t;
+
 /***************************************************************************
-*                                CONSTANTS
+* Standby dictionary for the LZW_FULL_STANDBY policy.  It is built from the
+* strings the encoder wrote while its dictionary was nearly full, exactly
+* as the encoder built its standby dictionary.
+***************************************************************************/
+typedef struct
+{
+    decode_dictionary_t *dictionary;    /* dictionary that replaces a full
+                                           one, up to STANDBY_LIMIT */
+    unsigned int *codes;        /* standby code for each active code word */
+    unsigned int *stack;        /* active code words waiting to be copied */
+    unsigned int size;          /* number of string code words */
+    unsigned int nextCode;      /* next available standby code word */
+    unsigned int start;         /* active code count that starts copying */
+    unsigned int limit;         /* standby code count that stops copying */
+    int priming;                /* strings are being copied */
+} standby_t;
+
+/***************************************************************************
+* Decoder context, may be reused for any number of streams.  A stream may
+* come from a file, from memory, or be fed to the decoder in pieces that
+* split code words anywhere.  Its tables are
+* for the maximum code word length in the last stream's header, and are
+* only freed when a stream needs a different length.  The dictionary starts
+* out with room for MIN_CODE_LEN bit code words and grows a code word
+* length at a time as entries are added, so streams that never use long
+* code words never allocate room for them.
 ***************************************************************************/
+struct lzw_decoder_t
+{
+    decode_dictionary_t *dictionary;    /* indexed by code word - FIRST_CODE */
+    unsigned int capacity;      /* number of entries in dictionary */
+    unsigned char *history;     /* history window + data to be written,
+                                   NULL until a stream needs it */
+    size_t historySize;         /* number of bytes allocated for history */
+    size_t window;              /* bytes of history kept when sliding */
+    size_t block;               /* unwritten bytes that stop decoding */
+    unsigned char *buffer;      /* history, or the caller's output memory */
+    size_t size;                /* number of bytes buffer can hold */
+    size_t buffered;            /* number of bytes in buffer */
+    size_t flushed;             /* number of bytes in buffer written */
+    unsigned long base;         /* output position of buffer[0] */
+    unsigned long swept;        /* output position of the last offset sweep */
+    FILE *fpOut;                /* file receiving decoded data, NULL if
+                                   decoding to memory */
+    int error;                  /* errno of the first output failure */
+    unsigned char maxCodeLen;   /* longest code word, 0 if no tables */
+    unsigned int clearCode;     /* all ones at maxCodeLen bits */
+    lzw_full_policy_t policy;   /* what the encoder did when it was full */
+    lru_t lru;                  /* code word use for LZW_FULL_LRU */
+    standby_t standby;          /* standby dictionary for LZW_FULL_STANDBY */
+
+    /* encoded input, unpacked CODE_BATCH code words at a time */
+    FILE *fpIn;                 /* file holding encoded data, NULL if
+                                   decoding from memory */
+    unsigned char inputBlock[INPUT_BLOCK];  /* encoded data from fpIn */
+    const unsigned char *input; /* inputBlock, or the caller's memory */
+    size_t inputNext;           /* next byte of input to unpack */
+    size_t inputCount;          /* number of bytes in input */
+    unsigned long bits;         /* unpacked input bits, oldest first */
+    unsigned int bitCount;      /* number of bits in the low end of bits */
+    unsigned char codeLen;      /* length of the next code word */
+    unsigned int growCode;      /* GROW_CODE(codeLen) */
+    int afterClear;             /* the next code word follows a clear */
+    unsigned int codes[CODE_BATCH];     /* unpacked code words */
+    unsigned int codeNext;      /* next code word in codes */
+    unsigned int codeCount;     /* number of code words in codes */
+
+    /* where decoding stopped, so it can continue */
+    decode_state_t state;       /* what the next input is */
+    unsigned int nextCode;      /* next unused code word */
+    unsigned int entryCode;     /* code word for next entry */
+    unsigned int lastCode;      /* last decoded code word */
+    unsigned long lastOffset;   /* output position of lastCode */
+    unsigned char lastChar;     /* first character of lastCode */
+};
 
 /***************************************************************************
 *                                  MACROS
 ***************************************************************************/
+/* position in the decoded output of the next byte to be decoded */
+#define OUTPUT_POSITION(decoder)    \
+    ((unsigned long)((decoder)->base + (decoder)->buffered))
 
 /***************************************************************************
-*                            GLOBAL VARIABLES
+* The buffer slides back to window bytes once it holds twice that, but
+* only when it's flushed.  It is flushed once it holds block unwritten
+* bytes, so it needs room for a block less one byte more, plus the longest
+* string the dictionary can hold, which is one character longer than the
+* number of entries.  That is never less than the INLINE_SIZE bytes stored
+* for a short string.  Files use HISTORY_SIZE and OUTPUT_BLOCK.  A decoder
+* being fed keeps much less, so that many streams can be open at once.
 ***************************************************************************/
+#define BUFFER_SIZE(window, block, capacity)    \
+    ((2 * (window)) + (block) + (capacity))
 
-/* dictionary of string the code word is the dictionary index */
-static decode_dictionary_t dictionary[(MAX_CODES - FIRST_CODE)];
+/* standby code word for an active string code word, 0 if none */
+#define STANDBY_CODE(standby, code) ((standby)->codes[(code) - FIRST_CODE])
+
+/***************************************************************************
+*                            GLOBAL VARIABLES
+***************************************************************************/
 
 /***************************************************************************
 *                               PROTOTYPES
 ***************************************************************************/
-static unsigned char DecodeRecursive(unsigned int code, FILE *fpOut);
+/* decoder table setup/free */
+static int PrepareDecoder(lzw_decoder_t *decoder, const int header);
+static void FreeDecoderTables(lzw_decoder_t *decoder);
+static int PrepareHistory(lzw_decoder_t *decoder, const size_t window,
+    const size_t block);
+static int GrowDictionary(lzw_decoder_t *decoder, const unsigned int code);
+
+static void EndStream(lzw_decoder_t *decoder);
+static int Decode(lzw_decoder_t *decoder);
+
+/* buffered output */
+static int PutChar(lzw_decoder_t *decoder, const unsigned char c);
+static void FlushOutput(lzw_decoder_t *decoder);
+static int OutputStatus(lzw_decoder_t *decoder);
+static void SweepOffsets(decode_dictionary_t *dictionary,
+    const unsigned int count, const unsigned long position);
+
+static int DecodeString(lzw_decoder_t *decoder, unsigned int code);
+static unsigned int NextEntryCode(lzw_decoder_t *decoder,
+    const unsigned int nextCode, const unsigned int lastCode);
+
+/* standby dictionary create/free/empty/use */
+static int MakeStandby(standby_t *standby, const unsigned char maxCodeLen);
+static void FreeStandby(standby_t *standby);
+static void ResetStandby(standby_t *standby);
+static void PrimeStandby(standby_t *standby,
+    const decode_dictionary_t *dictionary, unsigned int code,
+    const unsigned int nextCode);
+static unsigned int SwitchToStandby(decode_dictionary_t *dictionary,
+    standby_t *standby);
 
 /* read encoded data */
-static int GetCodeWord(bit_file_t *bfpIn, const unsigned char codeLen);
+static size_t FillInput(lzw_decoder_t *decoder);
+static unsigned int UnpackCodes(lzw_decoder_t *decoder);
+static int GetCodeWord(lzw_decoder_t *decoder);
 
 /***************************************************************************
 *                                FUNCTIONS
 ***************************************************************************/
 
+/***************************************************************************
+*   Function   : LZWCreateDecoder
+*   Description: This routine allocates a decoder context that may be used
+*                to decode any number of streams.  Each context is
+*                independent, so one may be used on each thread.  Its
+*                tables are allocated by the first stream it decodes,
+*                because their size comes from the stream's header.
+*   Parameters : None
+*   Effects    : Memory is allocated for the decoder
+*   Returned   : Pointer to the new decoder, NULL on failure.  errno will
+*                be set in the event of a failure.
+***************************************************************************/
+lzw_decoder_t *LZWCreateDecoder(void)
+{
+    lzw_decoder_t *decoder;
+
+    decoder = malloc(sizeof(lzw_decoder_t));
+
+    if (NULL == decoder)
+    {
+        return NULL;
+    }
+
+    decoder->dictionary = NULL;     /* allocated for the first stream */
+    decoder->history = NULL;
+    decoder->historySize = 0;
+    decoder->buffer = NULL;
+    decoder->maxCodeLen = 0;
+    decoder->error = 0;
+    decoder->lru.codes = NULL;
+    decoder->standby.dictionary = NULL;
+    decoder->standby.codes = NULL;
+    LZWDecoderStart(decoder);
+    return decoder;
+}
+
+/***************************************************************************
+*   Function   : LZWDestroyDecoder
+*   Description: This routine frees a decoder context created by
+*                LZWCreateDecoder.
+*   Parameters : decoder - decoder to free (may be NULL)
+*   Effects    : Memory allocated for the decoder is freed
+*   Returned   : None
+***************************************************************************/
+void LZWDestroyDecoder(lzw_decoder_t *decoder)
+{
+    if (NULL == decoder)
+    {
+        return;
+    }
+
+    FreeDecoderTables(decoder);
+    free(decoder);
+}
+
 /***************************************************************************
 *   Function   : LZWDecodeFile
-*   Description: This routine reads an input file 1 encoded string at a
-*                time and decodes it using the LZW algorithm.
+*   Description: This routine decodes an LZW encoded file using a
+*                temporary decoder context.
 *   Parameters : fpIn - pointer to the open binary file to decode
 *                fpOut - pointer to the open binary file to write decoded
 *                       output
-*   Effects    : fpIn is decoded using the LZW algorithm with CODE_LEN codes
-*                and written to fpOut.  Neither file is closed after exit.
+*   Effects    : fpIn is decoded and written to fpOut.  Neither file is
+*                closed after exit.
 *   Returned   : 0 for success, -1 for failure.  errno will be set in the
-*                event of a failure.
+*                event of a failure.  errno is ENOTSUP if the data was
+*                encoded with settings this decoder doesn't support, and
+*                EILSEQ if the encoded data is corrupt.
 ***************************************************************************/
 int LZWDecodeFile(FILE *fpIn, FILE *fpOut)
 {
-    bit_file_t *bfpIn;                  /* encoded input */
+    lzw_decoder_t *decoder;
+    int result;
 
-    unsigned int nextCode;              /* value of next code */
-    unsigned int lastCode;              /* last decoded code word */
-    unsigned int code;                  /* code word to decode */
-    unsigned char currentCodeLen;       /* length of code words now */
-    unsigned char c;                    /* last decoded character */
+    decoder = LZWCreateDecoder();
+
+    if (NULL == decoder)
+    {
+        return -1;
+    }
+
+    result = LZWDecoderDecodeFile(decoder, fpIn, fpOut);
+    LZWDestroyDecoder(decoder);
+
+    return result;
+}
+
+/***************************************************************************
+*   Function   : LZWDecoderDecodeFile
+*   Description: This routine reads an input file a block at a time and
+*                decodes it using the LZW algorithm, writing the decoded
+*                data a block at a time.
+*   Parameters : decoder - decoder context to use
+*                fpIn - pointer to the open binary file to decode
+*                fpOut - pointer to the open binary file to write decoded
+*                       output
+*   Effects    : fpIn is decoded using the LZW algorithm and written to
+*                fpOut.  Neither file is closed after exit.  The header
+*                tells the decoder the maximum code word length, which
+*                sizes its dictionary, and what the encoder did when its
+*                dictionary was full.  Code words start at MIN_CODE_LEN
+*                bits and grow up to that length.  The decoder's tables
+*                are reused if they are the right size.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  errno is ENOTSUP if the data was
+*                encoded with settings this decoder doesn't support, and
+*                EILSEQ if the encoded data is corrupt.  If writing fpOut
+*                fails, errno is the write's error.
+***************************************************************************/
+int LZWDecoderDecodeFile(lzw_decoder_t *decoder, FILE *fpIn, FILE *fpOut)
+{
+    int result;
 
     /* validate arguments */
-    if ((NULL == fpIn) || (NULL == fpOut))
+    if ((NULL == decoder) || (NULL == fpIn) || (NULL == fpOut))
     {
         errno = ENOENT;
         return -1;
     }
 
-    /* convert input file to bitfile */
-    bfpIn = MakeBitFile(fpIn, BF_READ);
+    decoder->fpIn = fpIn;
+    decoder->bits = 0;
+    decoder->bitCount = 0;
+
+    if (0 == FillInput(decoder))
+    {
+        /* empty file */
+        EndStream(decoder);
+        return 0;
+    }
+
+    /* the header sets the size of everything */
+    decoder->inputNext = 1;
 
-    if (NULL == bfpIn)
+    if (0 != PrepareDecoder(decoder, decoder->input[0]))
     {
-        perror("Making Input File a BitFile");
+        EndStream(decoder);
         return -1;
     }
 
-    /* start MIN_CODE_LEN bit code words */
-    currentCodeLen = MIN_CODE_LEN;
+    /* decoded data collects in the history buffer until it's written */
+    if (0 != PrepareHistory(decoder, HISTORY_SIZE, OUTPUT_BLOCK))
+    {
+        EndStream(decoder);
+        return -1;
+    }
+
+    decoder->fpOut = fpOut;
+
+    result = Decode(decoder);
+
+    if (0 == result)
+    {
+        /* we've decoded everything */
+        FlushOutput(decoder);
+        result = OutputStatus(decoder);
+    }
+
+    /* nothing of this stream may be fed to or drained from the decoder */
+    EndStream(decoder);
+    return result;
+}
+
+/***************************************************************************
+*   Function   : LZWDecodeBuffer
+*   Description: This routine decodes LZW encoded data in memory using a
+*                temporary decoder context.
+*   Parameters : in - encoded data
+*                inLen - number of bytes of encoded data
+*                out - memory to write decoded data to
+*                outCap - number of bytes out can hold
+*                outLen - set to the number of bytes decoded
+*   Effects    : in is decoded into out
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  errno is ENOBUFS if the decoded data
+*                doesn't fit in out.
+***************************************************************************/
+int LZWDecodeBuffer(const void *in, size_t inLen, void *out, size_t outCap,
+    size_t *outLen)
+{
+    lzw_decoder_t *decoder;
+    int result;
+
+    decoder = LZWCreateDecoder();
+
+    if (NULL == decoder)
+    {
+        return -1;
+    }
+
+    result = LZWDecoderDecodeBuffer(decoder, in, inLen, out, outCap, outLen);
+    LZWDestroyDecoder(decoder);
+
+    return result;
+}
+
+/***************************************************************************
+*   Function   : LZWDecoderDecodeBuffer
+*   Description: This routine decodes LZW encoded data in memory.  Code
+*                words are unpacked straight from in, and strings are
+*                decoded straight into out, which is also the history that
+*                long strings are copied from.  Neither stdio nor the
+*                decoder's output buffer is used.  Once the decoder's
+*                tables have grown for data like in, no memory is
+*                allocated.
+*   Parameters : decoder - decoder context to use
+*                in - encoded data
+*                inLen - number of bytes of encoded data
+*                out - memory to write decoded data to
+*                outCap - number of bytes out can hold
+*                outLen - set to the number of bytes decoded
+*   Effects    : in is decoded into out.  The decoder's tables are reused
+*                if they are the right size.  Neither in nor out is
+*                referred to after this routine returns.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  errno is ENOTSUP if the data was
+*                encoded with settings this decoder doesn't support,
+*                EILSEQ if the encoded data is corrupt, and ENOBUFS if the
+*                decoded data doesn't fit in out.  *outLen is the number
+*                of bytes decoded before the failure.
+***************************************************************************/
+int LZWDecoderDecodeBuffer(lzw_decoder_t *decoder, const void *in,
+    size_t inLen, void *out, size_t outCap, size_t *outLen)
+{
+    int result;
+
+    /* validate arguments */
+    if ((NULL == decoder) || ((NULL == in) && (0 != inLen)) ||
+        ((NULL == out) && (0 != outCap)) || (NULL == outLen))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    *outLen = 0;
+
+    if (0 == inLen)
+    {
+        /* empty input */
+        return 0;
+    }
+
+    /* all of the encoded data is already in memory */
+    decoder->fpIn = NULL;
+    decoder->input = in;
+    decoder->inputCount = inLen;
+    decoder->bits = 0;
+    decoder->bitCount = 0;
+
+    /* the header sets the size of everything */
+    decoder->inputNext = 1;
+
+    if (0 != PrepareDecoder(decoder, decoder->input[0]))
+    {
+        EndStream(decoder);
+        return -1;
+    }
+
+    /* out holds all of the decoded data, so it never slides */
+    decoder->buffer = out;
+    decoder->size = outCap;
+    decoder->fpOut = NULL;
+
+    result = Decode(decoder);
+    *outLen = decoder->buffered;
+
+    /* out and in belong to the caller once this returns */
+    EndStream(decoder);
+    return result;
+}
+
+/***************************************************************************
+*   Function   : LZWDecoderStart
+*   Description: This routine readies a decoder for a stream that will be
+*                fed to it in pieces with LZWDecoderFeed.
+*   Parameters : decoder - decoder context to use
+*   Effects    : Anything left of the decoder's last stream is discarded.
+*                The decoder's tables are kept for reuse.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+int LZWDecoderStart(lzw_decoder_t *decoder)
+{
+    if (NULL == decoder)
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    EndStream(decoder);
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : LZWDecoderFeed
+*   Description: This routine decodes the next piece of a stream started
+*                with LZWDecoderStart.  Pieces may split code words (or the
+*                strings they decode to) anywhere.  Decoded data collects
+*                in the decoder until LZWDecoderDrain takes it, and once a
+*                block is waiting, the rest of the piece is left unused.
+*   Parameters : decoder - decoder context to use
+*                in - next piece of encoded data
+*                inLen - number of bytes in the piece
+*                inUsed - set to the number of bytes used.  Any that
+*                         weren't must be fed again after draining.
+*   Effects    : The piece is decoded.  in isn't referred to after this
+*                routine returns.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  errno is ENOTSUP if the data was
+*                encoded with settings this decoder doesn't support, and
+*                EILSEQ if the encoded data is corrupt.
+***************************************************************************/
+int LZWDecoderFeed(lzw_decoder_t *decoder, const void *in, size_t inLen,
+    size_t *inUsed)
+{
+    int result;
+
+    /* validate arguments */
+    if ((NULL == decoder) || ((NULL == in) && (0 != inLen)) ||
+        (NULL == inUsed))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    *inUsed = 0;
+
+    if (0 == inLen)
+    {
+        return 0;
+    }
+
+    decoder->input = in;
+    decoder->inputNext = 0;
+    decoder->inputCount = inLen;
+
+    if (DECODE_HEADER == decoder->state)
+    {
+        /* the header sets the size of everything */
+        decoder->inputNext = 1;
+
+        /* decoded data waits in the history buffer to be drained */
+        if ((0 != PrepareDecoder(decoder, decoder->input[0])) ||
+            (0 != PrepareHistory(decoder, FED_HISTORY, FED_BLOCK)))
+        {
+            EndStream(decoder);
+            return -1;
+        }
+    }
+
+    result = Decode(decoder);
+    *inUsed = decoder->inputNext;
+
+    /* the rest of the piece belongs to the caller */
+    decoder->input = NULL;
+    decoder->inputNext = 0;
+    decoder->inputCount = 0;
+
+    return result;
+}
+
+/***************************************************************************
+*   Function   : LZWDecoderDrain
+*   Description: This routine takes decoded data from a decoder being fed
+*                with LZWDecoderFeed.  Code words that were fed, but
+*                haven't been decoded because decoded data was waiting,
+*                are decoded as room is made.
+*   Parameters : decoder - decoder context to use
+*                out - memory to copy decoded data to
+*                outCap - number of bytes out can hold
+*                outLen - set to the number of bytes copied to out
+*   Effects    : Decoded data is copied to out.  More code words may be
+*                decoded.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  Nothing is waiting once *outLen is
+*                less than outCap.
+***************************************************************************/
+int LZWDecoderDrain(lzw_decoder_t *decoder, void *out, size_t outCap,
+    size_t *outLen)
+{
+    size_t count;
+
+    /* validate arguments */
+    if ((NULL == decoder) || ((NULL == out) && (0 != outCap)) ||
+        (NULL == outLen))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    *outLen = 0;
+
+    if (DECODE_HEADER == decoder->state)
+    {
+        /* nothing has been fed */
+        return 0;
+    }
+
+    do
+    {
+        count = decoder->buffered - decoder->flushed;
+
+        if (count > (outCap - *outLen))
+        {
+            count = outCap - *outLen;
+        }
+
+        memcpy((unsigned char *)out + *outLen,
+            decoder->buffer + decoder->flushed, count);
+        decoder->flushed += count;
+        *outLen += count;
+        FlushOutput(decoder);
+
+        if (*outLen == outCap)
+        {
+            break;
+        }
+
+        /* there's room, decode code words that were held back */
+        if (0 != Decode(decoder))
+        {
+            return -1;
+        }
+    } while (decoder->buffered != decoder->flushed);
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : EndStream
+*   Description: This routine drops everything a decoder knows about its
+*                stream, so that the next data fed to it is taken to be
+*                the header of a new stream.
+*   Parameters : decoder - decoder context to use
+*   Effects    : The decoder forgets its files, its input, and any memory
+*                it was decoding to.  Decoded data that wasn't drained is
+*                discarded.  The decoder's tables are kept for reuse.
+*   Returned   : None
+***************************************************************************/
+static void EndStream(lzw_decoder_t *decoder)
+{
+    decoder->state = DECODE_HEADER;
+    decoder->fpIn = NULL;
+    decoder->input = NULL;
+    decoder->inputNext = 0;
+    decoder->inputCount = 0;
+    decoder->bits = 0;
+    decoder->bitCount = 0;
+    decoder->fpOut = NULL;
+    decoder->buffer = decoder->history;
+    decoder->buffered = 0;
+    decoder->flushed = 0;
+}
+
+/***************************************************************************
+*   Function   : Decode
+*   Description: This routine decodes a stream's code words into the
+*                decoder's output buffer.  The decoder has already read the
+*                stream's header.  Everything needed to continue is kept
+*                in the decoder, so decoding may stop between any two code
+*                words and pick up again on the next call.
+*   Parameters : decoder - decoder ready for the stream's code words
+*   Effects    : Code words are read from the decoder's input and decoded
+*                into its output buffer until the input runs out, a block
+*                of output is waiting to be drained, or writing the output
+*                file fails.  Full blocks may be written to the output
+*                file.  Code words are checked against the dictionary
+*                before they are used, so corrupt data can't make the
+*                decoder read outside of it.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  errno is EILSEQ if a code word
+*                couldn't have been written by the encoder.  Bad code words
+*                and write failures are reported until the decoder is given
+*                a new stream.
+***************************************************************************/
+static int Decode(lzw_decoder_t *decoder)
+{
+    unsigned int nextCode;              /* value of next code */
+    unsigned int entryCode;             /* code word for next entry */
+    unsigned int lastCode;              /* last decoded code word */
+    unsigned int code;                  /* code word to decode */
+    unsigned char c;                    /* last decoded character */
+    int result;                         /* decoded character or EOF */
+    decode_dictionary_t *entry;         /* new dictionary entry */
+    unsigned long offset;               /* output position of code */
+    unsigned long lastOffset;           /* output position of lastCode */
+
+    lru_t *lru;                         /* code word use, NULL if unused */
+    standby_t *standby;                 /* standby, NULL if unused */
+
+    if (DECODE_CORRUPT == decoder->state)
+    {
+        /* nothing after a bad code word can be decoded */
+        errno = EILSEQ;
+        return -1;
+    }
 
-    /* initialize for decoding */
-    nextCode = FIRST_CODE;  /* code for next (first) string */
+    lru = (LZW_FULL_LRU == decoder->policy) ? &decoder->lru : NULL;
+    standby = (LZW_FULL_STANDBY == decoder->policy) ? &decoder->standby : NULL;
 
-    /* first code from file must be a character.  use it for initial values */
-    lastCode = GetCodeWord(bfpIn, currentCodeLen);
-    c = lastCode;
-    fputc(lastCode, fpOut);
+    /* pick up where the last call left off */
+    nextCode = decoder->nextCode;
+    entryCode = decoder->entryCode;
+    lastCode = decoder->lastCode;
+    lastOffset = decoder->lastOffset;
+    c = decoder->lastChar;
 
-    /* decode rest of file */
-    while ((int)(code = GetCodeWord(bfpIn, currentCodeLen)) != EOF)
+    while (((decoder->buffered - decoder->flushed) < decoder->block) &&
+        (0 == decoder->error) &&
+        ((int)(code = GetCodeWord(decoder)) != EOF))
     {
+        if (DECODE_CODES != decoder->state)
+        {
+            if (DECODE_CLEARED == decoder->state)
+            {
+                if ((SWITCH_CODE == code) && (NULL != standby))
+                {
+                    /* encoder switched to its standby dictionary */
+                    if (((standby->nextCode - FIRST_CODE) >
+                        decoder->capacity) &&
+                        (0 != GrowDictionary(decoder, standby->nextCode - 1)))
+                    {
+                        return -1;
+                    }
+
+                    nextCode = SwitchToStandby(decoder->dictionary, standby);
+                    decoder->state = DECODE_SWITCHED;
+                    continue;
+                }
+
+                /* encoder emptied its dictionary, start over */
+                nextCode = FIRST_CODE;
+
+                if (NULL != lru)
+                {
+                    ResetLRU(lru);
+                }
+
+                if (NULL != standby)
+                {
+                    ResetStandby(standby);
+                }
+
+                decoder->state = DECODE_FIRST;
+            }
+
+            if ((DECODE_SWITCHED == decoder->state) ?
+                (code >= nextCode) : (code >= FIRST_CODE))
+            {
+                /* not a string in the new dictionary, or not a character */
+                decoder->state = DECODE_CORRUPT;
+                errno = EILSEQ;
+                return -1;
+            }
+
+            lastCode = code;
+            lastOffset = OUTPUT_POSITION(decoder);
 
-        /* look for code length increase marker */
-        while (((CURRENT_MAX_CODES(currentCodeLen) - 1) == code) &&
-            (currentCodeLen < MAX_CODE_LEN))
+            if (DECODE_SWITCHED == decoder->state)
+            {
+                /* code is in the new dictionary, and adds no entry */
+                result = DecodeString(decoder, lastCode);
+            }
+            else
+            {
+                /* first code of a stream or after a clear is a character */
+                result = PutChar(decoder, lastCode);
+            }
+
+            if (EOF == result)
+            {
+                return -1;
+            }
+
+            c = result;
+            entryCode = NextEntryCode(decoder, nextCode, lastCode);
+            decoder->state = DECODE_CODES;
+            continue;
+        }
+
+        /* code length increase markers were removed by UnpackCodes */
+        if (decoder->clearCode == code)
         {
-            currentCodeLen++;
-            code = GetCodeWord(bfpIn, currentCodeLen);
+            /* the next code word says what the encoder did */
+            decoder->state = DECODE_CLEARED;
+            continue;
         }
 
-        if (code < nextCode)
+        offset = OUTPUT_POSITION(decoder);
+
+        if ((code < nextCode) && (code != entryCode))
         {
             /* we have a known code.  decode it */
-            c = DecodeRecursive(code, fpOut);
+            result = DecodeString(decoder, code);
+        }
+        else if (code != entryCode)
+        {
+            /* the encoder hasn't assigned this code word to a string */
+            decoder->state = DECODE_CORRUPT;
+            errno = EILSEQ;
+            return -1;
         }
         else
         {
@@ -147,96 +846,949 @@ int LZWDecodeFile(FILE *fpIn, FILE *fpOut)
             * We got a code that's not in our dictionary.  This must be due
             * to the string + char + string + char + string exception.
             * Build the decoded string using the last character + the
-            * string from the last code.
+            * string from the last code.  The last code's string was just
+            * decoded, so it is copied from right before where it goes.
             ***************************************************************/
-            unsigned char tmp;
+            result = DecodeString(decoder, lastCode);
+
+            if ((EOF != result) && (EOF == PutChar(decoder, c)))
+            {
+                result = EOF;
+            }
+        }
 
-            tmp = c;
-            c = DecodeRecursive(lastCode, fpOut);
-            fputc(tmp, fpOut);
+        if (EOF == result)
+        {
+            return -1;
         }
 
+        c = result;
+
         /* if room, add new code to the dictionary */
-        if (nextCode < MAX_CODES)
+        if (entryCode != decoder->clearCode)
         {
-            dictionary[nextCode - FIRST_CODE].prefixCode = lastCode;
-            dictionary[nextCode - FIRST_CODE].suffixChar = c;
-            nextCode++;
+            if (((entryCode - FIRST_CODE) >= decoder->capacity) &&
+                (0 != GrowDictionary(decoder, entryCode)))
+            {
+                return -1;
+            }
+
+            entry = &decoder->dictionary[entryCode - FIRST_CODE];
+            entry->prefixCode = lastCode;
+            entry->suffixChar = c;
+
+            if (lastCode < FIRST_CODE)
+            {
+                entry->length = 2;
+                entry->firstChar = lastCode;
+                entry->string.chars[0] = lastCode;
+            }
+            else
+            {
+                entry->length =
+                    decoder->dictionary[lastCode - FIRST_CODE].length + 1;
+                entry->firstChar =
+                    decoder->dictionary[lastCode - FIRST_CODE].firstChar;
+
+                if (entry->length <= INLINE_SIZE)
+                {
+                    /* short strings extend their prefix's copy */
+                    memcpy(entry->string.chars, decoder->dictionary[lastCode -
+                        FIRST_CODE].string.chars, INLINE_SIZE);
+                }
+            }
+
+            if (entry->length <= INLINE_SIZE)
+            {
+                entry->string.chars[entry->length - 1] = c;
+            }
+            else
+            {
+                /* the last code's string was followed by c */
+                entry->string.offset = lastOffset;
+            }
+
+            if (NULL != lru)
+            {
+                LRUAddCode(lru, entryCode, lastCode);
+            }
+
+            if (entryCode == nextCode)
+            {
+                nextCode++;
+            }
         }
 
         /* save character and code for use in unknown code word case */
         lastCode = code;
+        lastOffset = offset;
+        entryCode = NextEntryCode(decoder, nextCode, lastCode);
     }
 
-    /* we've decoded everything, free bitfile structure */
-    BitFileToFILE(bfpIn);
-
-    return 0;
+    decoder->nextCode = nextCode;
+    decoder->entryCode = entryCode;
+    decoder->lastCode = lastCode;
+    decoder->lastOffset = lastOffset;
+    decoder->lastChar = c;
+    return OutputStatus(decoder);
 }
 
 /***************************************************************************
-*   Function   : DecodeRecursive
-*   Description: This function uses the dictionary to decode a code word
-*                into the string it represents and write it to the output
-*                file.  The string is actually built in reverse order and
-*                recursion is used to write it out in the correct order.
-*   Parameters : code - the code word to decode
-*                fpOut - the file that the decoded code word is written to
-*   Effects    : Decoded code word is written to a file
-*   Returned   : The first character in the decoded string
+*   Function   : PrepareDecoder
+*   Description: This function checks a stream's header and readies the
+*                decoder for the stream.  Its dictionary must be for the
+*                stream's maximum code word length, and it needs the data
+*                used to follow the stream's full dictionary policy.
+*                Tables for the right length are reused, at whatever size
+*                they have grown to.  Otherwise the dictionary starts out
+*                sized for MIN_CODE_LEN bit code words, and the history
+*                buffer is left for PrepareHistory to allocate.
+*   Parameters : decoder - the decoder to ready
+*                header - the stream's header byte
+*   Effects    : The decoder's tables may be freed and allocated
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  errno is ENOTSUP if the header holds
+*                settings this decoder doesn't support.
 ***************************************************************************/
-static unsigned char DecodeRecursive(unsigned int code, FILE *fpOut)
+static int PrepareDecoder(lzw_decoder_t *decoder, const int header)
 {
-    unsigned char c;
-    unsigned char firstChar;
+    unsigned char maxCodeLen;
+    lzw_full_policy_t policy;
 
-    if (code >= FIRST_CODE)
-    {
-        /* code word is string + c */
-        c = dictionary[code - FIRST_CODE].suffixChar;
-        code = dictionary[code - FIRST_CODE].prefixCode;
+    maxCodeLen = header & HEADER_LEN_MASK;
+    policy = (lzw_full_policy_t)(header >> HEADER_LEN_BITS);
 
-        /* evaluate new code word for remaining string */
-        firstChar = DecodeRecursive(code, fpOut);
-    }
-    else
+    if ((maxCodeLen < MIN_CODE_LEN) || (maxCodeLen > MAX_CODE_LEN) ||
+        ((LZW_FULL_RESET != policy) && (LZW_FULL_LRU != policy) &&
+        (LZW_FULL_STANDBY != policy) && (LZW_FULL_FREEZE != policy)))
     {
-        /* code word is just c */
-        c = code;
-        firstChar = code;
+        /* encoded with settings this decoder doesn't support */
+        errno = ENOTSUP;
+        return -1;
     }
 
-    fputc(c, fpOut);
-    return firstChar;
-}
+    if (maxCodeLen != decoder->maxCodeLen)
+    {
+        /* tables are for a different length (or don't exist) */
+        FreeDecoderTables(decoder);
+        decoder->clearCode = CLEAR_CODE(maxCodeLen);
+        decoder->capacity = CURRENT_MAX_CODES(MIN_CODE_LEN) - FIRST_CODE;
 
-/***************************************************************************
-*   Function   : GetCodeWord
-*   Description: This function reads and returns a code word from an
-*                encoded file.  In order to deal with endian issue the
-*                code word is read least significant byte followed by the
-*                remaining bits.
-*   Parameters : bfpIn - bit file containing the encoded data
-*                codeLen - number of bits in code word
-*   Effects    : code word is read from encoded input
-*   Returned   : The next code word in the encoded file.  EOF if the end
-*                of file has been reached.
-*
-*   NOTE: If the code word contains more than 16 bits, this routine should
-*         be modified to read in all the bytes from least significant to
-*         most significant followed by any left over bits.
-***************************************************************************/
-static int GetCodeWord(bit_file_t *bfpIn, const unsigned char codeLen)
-{
-    int code = 0;
-    int count;
+        if (decoder->capacity > (decoder->clearCode - FIRST_CODE))
+        {
+            /* MIN_CODE_LEN is the maximum, no room for the clear code */
+            decoder->capacity = decoder->clearCode - FIRST_CODE;
+        }
 
-    count = BitFileGetBitsNum(bfpIn, &code, codeLen, sizeof(code));
+        decoder->dictionary =
+            calloc(decoder->capacity, sizeof(decode_dictionary_t));
 
-    if (count < codeLen)
-    {
-        code = EOF;     /* BitFileGetBitsNum gives partial results at EOF */
+        if (NULL == decoder->dictionary)
+        {
+            return -1;
+        }
+
+        decoder->maxCodeLen = maxCodeLen;
+    }
+
+    if (LZW_FULL_LRU == policy)
+    {
+        if ((NULL == decoder->lru.codes) &&
+            (0 != MakeLRU(&decoder->lru, maxCodeLen)))
+        {
+            return -1;
+        }
+
+        ResetLRU(&decoder->lru);
+    }
+    else if (LZW_FULL_STANDBY == policy)
+    {
+        if ((NULL == decoder->standby.codes) &&
+            (0 != MakeStandby(&decoder->standby, maxCodeLen)))
+        {
+            return -1;
+        }
+
+        ResetStandby(&decoder->standby);
+    }
+
+    decoder->policy = policy;
+    decoder->error = 0;
+    decoder->window = HISTORY_SIZE;     /* PrepareHistory may change these */
+    decoder->block = OUTPUT_BLOCK;
+    decoder->buffered = 0;
+    decoder->flushed = 0;
+    decoder->base = 0;
+    decoder->swept = 0;
+
+    /* the first code word is a character for an empty dictionary */
+    decoder->state = DECODE_FIRST;
+    decoder->nextCode = FIRST_CODE;
+
+    /* start MIN_CODE_LEN bit code words */
+    decoder->codeLen = MIN_CODE_LEN;
+    decoder->growCode = GROW_CODE(MIN_CODE_LEN);
+    decoder->afterClear = 0;
+    decoder->codeNext = 0;
+    decoder->codeCount = 0;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : FreeDecoderTables
+*   Description: This function frees every table allocated for a decoder
+*                by PrepareDecoder.
+*   Parameters : decoder - the decoder whose tables are freed
+*   Effects    : Memory allocated for the decoder's tables is freed
+*   Returned   : None
+***************************************************************************/
+static void FreeDecoderTables(lzw_decoder_t *decoder)
+{
+    free(decoder->dictionary);
+    free(decoder->history);
+    decoder->dictionary = NULL;
+    decoder->history = NULL;
+    decoder->historySize = 0;
+    decoder->buffer = NULL;
+    decoder->maxCodeLen = 0;
+
+    FreeLRU(&decoder->lru);
+    FreeStandby(&decoder->standby);
+}
+
+/***************************************************************************
+*   Function   : PrepareHistory
+*   Description: This function readies the history buffer that decoded data
+*                collects in when it's written to a file or drained.
+*                Decoding to memory doesn't use it, so it's only allocated
+*                for the first stream that does.  A buffer that is already
+*                large enough is kept.
+*   Parameters : decoder - the decoder, ready for a stream
+*                window - bytes of history to keep when the buffer slides
+*                block - unwritten bytes that stop decoding
+*   Effects    : The history buffer may be allocated, and becomes the
+*                buffer decoded data goes to.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int PrepareHistory(lzw_decoder_t *decoder, const size_t window,
+    const size_t block)
+{
+    size_t size;
+
+    decoder->window = window;
+    decoder->block = block;
+    size = BUFFER_SIZE(window, block, decoder->capacity);
+
+    if (decoder->historySize < size)
+    {
+        free(decoder->history);
+        decoder->historySize = 0;
+        decoder->history = malloc(size);
+
+        if (NULL == decoder->history)
+        {
+            return -1;
+        }
+
+        decoder->historySize = size;
+    }
+
+    decoder->buffer = decoder->history;
+    decoder->size = decoder->historySize;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : GrowDictionary
+*   Description: This function grows the decoder's dictionary so that it
+*                has an entry for a code word.  The dictionary grows a code
+*                word length at a time, up to the stream's maximum.  If
+*                decoded data is going to the history buffer, it grows with
+*                the dictionary to hold the longest string the larger
+*                dictionary can.  Otherwise it's freed, and allocated at
+*                the larger size when it's needed.
+*   Parameters : decoder - the decoder whose dictionary is grown
+*                code - string code word that needs an entry
+*   Effects    : The dictionary and history buffer are reallocated.  Their
+*                contents are kept, and the new entries are zeroed.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int GrowDictionary(lzw_decoder_t *decoder, const unsigned int code)
+{
+    unsigned int capacity;
+    size_t size;
+    void *grown;
+    int inHistory;              /* decoded data goes to history */
+
+    capacity = decoder->capacity;
+    inHistory = (NULL != decoder->history) &&
+        (decoder->buffer == decoder->history);
+
+    while (capacity <= (code - FIRST_CODE))
+    {
+        /* room for code words one bit longer */
+        capacity = (2 * (capacity + FIRST_CODE)) - FIRST_CODE;
+    }
+
+    if (capacity > (decoder->clearCode - FIRST_CODE))
+    {
+        capacity = decoder->clearCode - FIRST_CODE;
+    }
+
+    if (inHistory)
+    {
+        size = BUFFER_SIZE(decoder->window, decoder->block, capacity);
+
+        if (decoder->historySize < size)
+        {
+            grown = realloc(decoder->history, size);
+
+            if (NULL == grown)
+            {
+                return -1;
+            }
+
+            decoder->history = grown;
+            decoder->historySize = size;
+            decoder->buffer = decoder->history;
+            decoder->size = size;
+        }
+    }
+    else
+    {
+        /* not in use, it's allocated at the new size when it is */
+        free(decoder->history);
+        decoder->history = NULL;
+        decoder->historySize = 0;
+    }
+
+    grown = realloc(decoder->dictionary,
+        capacity * sizeof(decode_dictionary_t));
+
+    if (NULL == grown)
+    {
+        return -1;
+    }
+
+    decoder->dictionary = grown;
+
+    /* new entries hold no strings until they're added */
+    memset(decoder->dictionary + decoder->capacity, 0,
+        (capacity - decoder->capacity) * sizeof(decode_dictionary_t));
+    decoder->capacity = capacity;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : PutChar
+*   Description: This function adds a decoded character to the decoder's
+*                output buffer, writing the buffer out once it holds a
+*                block that hasn't been written.
+*   Parameters : decoder - the decoder and its output buffer
+*                c - the decoded character
+*   Effects    : c is buffered.  A full block may be written to fpOut.
+*   Returned   : c, or EOF if the output buffer is full.  That only
+*                happens when decoding to memory.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int PutChar(lzw_decoder_t *decoder, const unsigned char c)
+{
+    if (decoder->buffered == decoder->size)
+    {
+        errno = ENOBUFS;
+        return EOF;
+    }
+
+    decoder->buffer[decoder->buffered] = c;
+    decoder->buffered++;
+
+    if ((decoder->buffered - decoder->flushed) >= decoder->block)
+    {
+        FlushOutput(decoder);
+    }
+
+    return c;
+}
+
+/***************************************************************************
+*   Function   : FlushOutput
+*   Description: This function writes everything in the decoder's output
+*                buffer that hasn't been written to its output file.  If
+*                the buffer holds more than twice the history window, it
+*                slides back so that only the history window is kept.
+*                Memory being decoded to is never written or slid.  When
+*                there is no output file, the data is left for
+*                LZWDecoderDrain, and only drained data slides out.
+*   Parameters : decoder - the decoder and its output buffer
+*   Effects    : Buffered data is written to fpOut.  The first failure is
+*                recorded in the decoder.  The oldest data may be dropped
+*                from the buffer.  String offsets are swept every
+*                SWEEP_INTERVAL bytes.
+*   Returned   : None
+***************************************************************************/
+static void FlushOutput(lzw_decoder_t *decoder)
+{
+    size_t count, dropped;
+
+    if ((OUTPUT_POSITION(decoder) - decoder->swept) >= SWEEP_INTERVAL)
+    {
+        /* keep old offsets from wrapping around to recent ones */
+        decoder->swept = OUTPUT_POSITION(decoder);
+        SweepOffsets(decoder->dictionary, decoder->capacity, decoder->swept);
+
+        if (NULL != decoder->standby.dictionary)
+        {
+            /* standby strings are copied with their offsets */
+            SweepOffsets(decoder->standby.dictionary,
+                decoder->standby.limit - FIRST_CODE, decoder->swept);
+        }
+    }
+
+    if (decoder->buffer != decoder->history)
+    {
+        /* decoded data is already where it belongs */
+        decoder->flushed = decoder->buffered;
+        return;
+    }
+
+    count = decoder->buffered - decoder->flushed;
+
+    if (NULL != decoder->fpOut)
+    {
+        if ((fwrite(decoder->buffer + decoder->flushed, 1, count,
+            decoder->fpOut) != count) && (0 == decoder->error))
+        {
+            decoder->error = (0 != errno) ? errno : EIO;
+        }
+
+        decoder->flushed = decoder->buffered;
+    }
+
+    if (decoder->buffered >= (2 * decoder->window))
+    {
+        /* keep the newest window bytes, and any that weren't used */
+        dropped = decoder->buffered - decoder->window;
+
+        if (dropped > decoder->flushed)
+        {
+            dropped = decoder->flushed;
+        }
+
+        memmove(decoder->buffer, decoder->buffer + dropped,
+            decoder->buffered - dropped);
+        decoder->base += dropped;
+        decoder->buffered -= dropped;
+        decoder->flushed -= dropped;
+    }
+}
+
+/***************************************************************************
+*   Function   : OutputStatus
+*   Description: This function reports whether all of the decoder's output
+*                has been written so far.
+*   Parameters : decoder - decoder context to check
+*   Effects    : errno is set to the first output failure, if there was one
+*   Returned   : 0 if there were no output failures, otherwise -1.
+***************************************************************************/
+static int OutputStatus(lzw_decoder_t *decoder)
+{
+    if (0 != decoder->error)
+    {
+        errno = decoder->error;
+        return -1;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : SweepOffsets
+*   Description: This function moves the offsets of strings whose newest
+*                copy is more than SWEEP_INTERVAL bytes back to
+*                FAR_DISTANCE bytes back, so that they can't wrap around
+*                to look recent.  Unused entries are zeroed, so they look
+*                like short strings and are skipped.
+*   Parameters : dictionary - the dictionary to sweep
+*                count - number of entries in the dictionary
+*                position - the current output position
+*   Effects    : Old offsets are changed.  Their strings will be rebuilt
+*                from their prefixes.
+*   Returned   : None
+***************************************************************************/
+static void SweepOffsets(decode_dictionary_t *dictionary,
+    const unsigned int count, const unsigned long position)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+    {
+        if ((dictionary[i].length > INLINE_SIZE) &&
+            ((position - dictionary[i].string.offset) > SWEEP_INTERVAL))
+        {
+            dictionary[i].string.offset = position - FAR_DISTANCE;
+        }
+    }
+}
+
+/***************************************************************************
+*   Function   : DecodeString
+*   Description: This function uses the dictionary to decode a code word
+*                into the string it represents and add it to the output
+*                buffer.  Short strings are kept in their dictionary entry,
+*                and are stored with one INLINE_SIZE byte copy.  Longer
+*                strings have already been decoded at least once, so if the
+*                newest copy is still in the history window it is copied
+*                from there.  Otherwise following prefix codes gives the
+*                string's characters in reverse order, so the string is
+*                stored from its end, whose position comes from the
+*                dictionary entry's length, back to its start.
+*   Parameters : decoder - the decoder's dictionary and output buffer
+*                code - the code word to decode
+*   Effects    : Decoded code word is buffered.  Strings that aren't kept
+*                in their entry record it as their newest copy.  A full
+*                block may be written to fpOut.
+*   Returned   : The first character in the decoded string, or EOF if it
+*                doesn't fit in the output buffer.  That only happens when
+*                decoding to memory.  errno will be set in the event of a
+*                failure.
+***************************************************************************/
+static int DecodeString(lzw_decoder_t *decoder, unsigned int code)
+{
+    decode_dictionary_t *entry;
+    unsigned char *start, *next;
+    size_t room;
+    unsigned long distance;     /* how far back the newest copy starts */
+
+    if (code < FIRST_CODE)
+    {
+        /* code word is just a character */
+        return PutChar(decoder, code);
+    }
+
+    entry = &decoder->dictionary[code - FIRST_CODE];
+    room = decoder->size - decoder->buffered;
+
+    if (entry->length > room)
+    {
+        errno = ENOBUFS;
+        return EOF;
+    }
+
+    start = decoder->buffer + decoder->buffered;
+
+    if (entry->length <= INLINE_SIZE)
+    {
+        /* bytes past the string's end, if there's room, will be overwritten */
+        memcpy(start, entry->string.chars,
+            (room < INLINE_SIZE) ? entry->length : INLINE_SIZE);
+    }
+    else
+    {
+        distance = OUTPUT_POSITION(decoder) - entry->string.offset;
+
+        if ((distance <= decoder->buffered) && (distance < FAR_DISTANCE))
+        {
+            /* the copy ends at or before start, so they can't overlap */
+            memcpy(start, start - distance, entry->length);
+        }
+        else
+        {
+            /* fill in all but the first character, last one first */
+            for (next = start + entry->length - 1; next > start; next--)
+            {
+                *next = decoder->dictionary[code - FIRST_CODE].suffixChar;
+                code = decoder->dictionary[code - FIRST_CODE].prefixCode;
+            }
+
+            *next = entry->firstChar;
+        }
+
+        entry->string.offset = OUTPUT_POSITION(decoder);
+    }
+
+    decoder->buffered += entry->length;
+
+    if ((decoder->buffered - decoder->flushed) >= decoder->block)
+    {
+        FlushOutput(decoder);
+    }
+
+    return entry->firstChar;
+}
+
+/***************************************************************************
+*   Function   : NextEntryCode
+*   Description: This function determines which code word the encoder
+*                assigned to the string it added after writing lastCode.
+*                The decoder only learns that string's last character from
+*                the next code word, but it needs the code word first to
+*                recognize the string + char + string + char + string
+*                exception.  When the encoder recycles code words, this
+*                makes the same choice it did at the same point.  It also
+*                copies lastCode into the standby dictionary, as the
+*                encoder did when it wrote lastCode.
+*   Parameters : decoder - the decoder's dictionary and policy data
+*                nextCode - the next code word that has never been used
+*                lastCode - the code word just decoded
+*   Effects    : lastCode is marked as used.  A recycled code word's string
+*                is removed from the code word use data.  Strings may be
+*                added to the standby dictionary.
+*   Returned   : The code word for the next dictionary entry, or the clear
+*                code if no entry will be added.
+***************************************************************************/
+static unsigned int NextEntryCode(lzw_decoder_t *decoder,
+    const unsigned int nextCode, const unsigned int lastCode)
+{
+    unsigned int victim;
+
+    if (LZW_FULL_LRU == decoder->policy)
+    {
+        LRUUseCode(&decoder->lru, lastCode);
+    }
+    else if (LZW_FULL_STANDBY == decoder->policy)
+    {
+        PrimeStandby(&decoder->standby, decoder->dictionary, lastCode,
+            nextCode);
+    }
+
+    if (nextCode < decoder->clearCode)
+    {
+        return nextCode;
+    }
+
+    if (LZW_FULL_LRU != decoder->policy)
+    {
+        /* full, wait for a clear */
+        return decoder->clearCode;
+    }
+
+    victim = LRUFindVictim(&decoder->lru, lastCode);
+
+    if (decoder->clearCode != victim)
+    {
+        LRURemoveCode(&decoder->lru,
+            decoder->dictionary[victim - FIRST_CODE].prefixCode);
+    }
+
+    return victim;
+}
+
+/***************************************************************************
+*   Function   : MakeStandby
+*   Description: This function allocates a standby dictionary along with
+*                the table mapping active code words to standby code words.
+*   Parameters : standby - pointer to the standby dictionary to initialize
+*                maxCodeLen - maximum code word length
+*   Effects    : Memory is allocated for the standby dictionary
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int MakeStandby(standby_t *standby, const unsigned char maxCodeLen)
+{
+    standby->start = STANDBY_START(maxCodeLen);
+    standby->limit = STANDBY_LIMIT(maxCodeLen);
+    standby->dictionary =
+        calloc(standby->limit - FIRST_CODE, sizeof(decode_dictionary_t));
+
+    if (NULL == standby->dictionary)
+    {
+        return -1;
+    }
+
+    /* code map and stack share an allocation */
+    standby->size = CURRENT_MAX_CODES(maxCodeLen) - FIRST_CODE;
+    standby->codes = malloc(2 * standby->size * sizeof(unsigned int));
+
+    if (NULL == standby->codes)
+    {
+        free(standby->dictionary);
+        return -1;
+    }
+
+    standby->stack = standby->codes + standby->size;
+    ResetStandby(standby);
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : FreeStandby
+*   Description: This function frees a standby dictionary allocated by
+*                MakeStandby.
+*   Parameters : standby - pointer to the standby dictionary to free
+*   Effects    : Memory allocated for the standby dictionary is freed
+*   Returned   : None
+***************************************************************************/
+static void FreeStandby(standby_t *standby)
+{
+    free(standby->dictionary);
+    free(standby->codes);
+    standby->dictionary = NULL;
+    standby->codes = NULL;
+    standby->stack = NULL;
+}
+
+/***************************************************************************
+*   Function   : ResetStandby
+*   Description: This function empties a standby dictionary and stops
+*                copying strings into it.
+*   Parameters : standby - pointer to the standby dictionary to empty
+*   Effects    : Every string is removed from the standby dictionary
+*   Returned   : None
+***************************************************************************/
+static void ResetStandby(standby_t *standby)
+{
+    standby->nextCode = FIRST_CODE;
+    standby->priming = 0;
+}
+
+/***************************************************************************
+*   Function   : PrimeStandby
+*   Description: This function copies a string that was just decoded from
+*                the active dictionary into the standby dictionary, along
+*                with any of its prefixes that aren't there yet, the same
+*                way the encoder's PrimeStandby does.
+*   Parameters : standby - pointer to the standby dictionary
+*                dictionary - the active dictionary
+*                code - active code word that was just decoded
+*                nextCode - next available active code word
+*   Effects    : Strings are added to the standby dictionary
+*   Returned   : None
+***************************************************************************/
+static void PrimeStandby(standby_t *standby,
+    const decode_dictionary_t *dictionary, unsigned int code,
+    const unsigned int nextCode)
+{
+    unsigned int depth, prefixCode;
+
+    if (!standby->priming)
+    {
+        if (nextCode < standby->start)
+        {
+            return;
+        }
+
+        /* no active code word has a standby code word yet */
+        memset(standby->codes, 0, standby->size * sizeof(unsigned int));
+        standby->priming = 1;
+    }
+
+    if (standby->nextCode >= standby->limit)
+    {
+        return;
+    }
+
+    /* walk back to a prefix the standby dictionary already has */
+    depth = 0;
+
+    while ((code >= FIRST_CODE) && (0 == STANDBY_CODE(standby, code)))
+    {
+        standby->stack[depth] = code;
+        depth++;
+        code = dictionary[code - FIRST_CODE].prefixCode;
+    }
+
+    prefixCode = (code < FIRST_CODE) ? code : STANDBY_CODE(standby, code);
+
+    /* copy the missing strings, shortest first */
+    while ((depth > 0) && (standby->nextCode < standby->limit))
+    {
+        depth--;
+        code = standby->stack[depth];
+
+        standby->dictionary[standby->nextCode - FIRST_CODE].prefixCode =
+            prefixCode;
+        standby->dictionary[standby->nextCode - FIRST_CODE].suffixChar =
+            dictionary[code - FIRST_CODE].suffixChar;
+        standby->dictionary[standby->nextCode - FIRST_CODE].length =
+            dictionary[code - FIRST_CODE].length;
+        standby->dictionary[standby->nextCode - FIRST_CODE].firstChar =
+            dictionary[code - FIRST_CODE].firstChar;
+        standby->dictionary[standby->nextCode - FIRST_CODE].string =
+            dictionary[code - FIRST_CODE].string;
+        STANDBY_CODE(standby, code) = standby->nextCode;
+
+        prefixCode = standby->nextCode;
+        standby->nextCode++;
+    }
+}
+
+/***************************************************************************
+*   Function   : SwitchToStandby
+*   Description: This function replaces the active dictionary with the
+*                standby dictionary and empties the standby dictionary.
+*   Parameters : dictionary - the active dictionary
+*                standby - pointer to the standby dictionary
+*   Effects    : The standby dictionary's strings are copied over the
+*                active dictionary
+*   Returned   : The next available code word in the new active dictionary
+***************************************************************************/
+static unsigned int SwitchToStandby(decode_dictionary_t *dictionary,
+    standby_t *standby)
+{
+    unsigned int nextCode;
+
+    nextCode = standby->nextCode;
+    memcpy(dictionary, standby->dictionary,
+        (nextCode - FIRST_CODE) * sizeof(decode_dictionary_t));
+
+    ResetStandby(standby);
+    return nextCode;
+}
+
+/***************************************************************************
+*   Function   : FillInput
+*   Description: This function reads the next block of encoded data into
+*                the decoder's input buffer.  Encoded data in memory is
+*                all read at once, so there is never more of it.
+*   Parameters : decoder - the decoder and its input buffer
+*   Effects    : Up to INPUT_BLOCK bytes are read from fpIn
+*   Returned   : The number of bytes read, 0 at the end of the file.
+***************************************************************************/
+static size_t FillInput(lzw_decoder_t *decoder)
+{
+    if (NULL == decoder->fpIn)
+    {
+        return 0;
+    }
+
+    decoder->input = decoder->inputBlock;
+    decoder->inputCount =
+        fread(decoder->inputBlock, 1, INPUT_BLOCK, decoder->fpIn);
+    decoder->inputNext = 0;
+    return decoder->inputCount;
+}
+
+/***************************************************************************
+*   Function   : UnpackCodes
+*   Description: This function unpacks up to CODE_BATCH code words from
+*                the encoded input into the decoder's code word array.
+*                Code length increase markers are acted on here and left
+*                out of the array, and so is the length change after a
+*                clear code, so the decoder only sees code words.  Code
+*                words are packed least significant byte first, followed
+*                by the remaining bits, the way BitFilePutBitsNum writes
+*                them, and are unpacked with masks and shifts that are
+*                only computed when the code word length changes.  All of
+*                the bits are taken from the input most significant bit
+*                first.
+*   Parameters : decoder - the decoder and its encoded input
+*   Effects    : Encoded input is consumed and the code word array is
+*                refilled.
+*   Returned   : The number of code words unpacked, 0 if the end of the
+*                file has been reached.  A partial code word at the end of
+*                the file is ignored.
+***************************************************************************/
+static unsigned int UnpackCodes(lzw_decoder_t *decoder)
+{
+    unsigned long bits;         /* local copies of the unpacking state */
+    unsigned int bitCount;
+    unsigned char codeLen;
+    unsigned int growCode;
+    unsigned int count;         /* number of code words unpacked */
+    unsigned int value;         /* code word's bits in input order */
+    unsigned int code;
+    code_order_t order;         /* unpacks codeLen bit code words */
+
+    bits = decoder->bits;
+    bitCount = decoder->bitCount;
+    codeLen = decoder->codeLen;
+    growCode = decoder->growCode;
+    SET_CODE_ORDER(order, codeLen);
+    count = 0;
+
+    while (count < CODE_BATCH)
+    {
+        while (bitCount < codeLen)
+        {
+            if ((decoder->inputNext == decoder->inputCount) &&
+                (0 == FillInput(decoder)))
+            {
+                /* end of file */
+                decoder->bits = bits;
+                decoder->bitCount = bitCount;
+                decoder->codeLen = codeLen;
+                decoder->growCode = growCode;
+                return count;
+            }
+
+            bits = (bits << CHAR_BIT) | decoder->input[decoder->inputNext];
+            decoder->inputNext++;
+            bitCount += CHAR_BIT;
+        }
+
+        bitCount -= codeLen;
+        value = (unsigned int)(bits >> bitCount) & GROW_CODE(codeLen);
+
+        /* whole bytes come least significant first, then leftover bits */
+        code = UNPACK_CODE(order, value);
+
+        if (decoder->afterClear)
+        {
+            /* standby switches keep the longest code words */
+            decoder->afterClear = 0;
+
+            if ((SWITCH_CODE == code) &&
+                (LZW_FULL_STANDBY == decoder->policy))
+            {
+                codeLen = decoder->maxCodeLen;
+                growCode = GROW_CODE(codeLen);
+                SET_CODE_ORDER(order, codeLen);
+            }
+        }
+        else if (growCode == code)
+        {
+            if (codeLen < decoder->maxCodeLen)
+            {
+                /* code length increase marker */
+                codeLen++;
+                growCode = GROW_CODE(codeLen);
+                SET_CODE_ORDER(order, codeLen);
+                continue;
+            }
+
+            /* clear code, the next code word is MIN_CODE_LEN bits */
+            codeLen = MIN_CODE_LEN;
+            growCode = GROW_CODE(codeLen);
+            SET_CODE_ORDER(order, codeLen);
+            decoder->afterClear = 1;
+        }
+
+        decoder->codes[count] = code;
+        count++;
+    }
+
+    decoder->bits = bits;
+    decoder->bitCount = bitCount;
+    decoder->codeLen = codeLen;
+    decoder->growCode = growCode;
+    return count;
+}
+
+/***************************************************************************
+*   Function   : GetCodeWord
+*   Description: This function returns the next code word from the
+*                decoder's array of unpacked code words, unpacking another
+*                batch when the array is used up.
+*   Parameters : decoder - the decoder and its encoded input
+*   Effects    : A code word is consumed, and more may be unpacked
+*   Returned   : The next code word in the encoded file.  EOF if the end
+*                of file has been reached.
+***************************************************************************/
+static int GetCodeWord(lzw_decoder_t *decoder)
+{
+    if (decoder->codeNext == decoder->codeCount)
+    {
+        decoder->codeNext = 0;
+        decoder->codeCount = UnpackCodes(decoder);
+
+        if (0 == decoder->codeCount)
+        {
+            return EOF;
+        }
     }
 
-    return code;
+    decoder->codeNext++;
+    return decoder->codes[decoder->codeNext - 1];
 }
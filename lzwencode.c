@@ -35,33 +35,164 @@
 ***************************************************************************/
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include "lzw.h"
 #include "lzwlocal.h"
-#include "bitfile/bitfile.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define NO_CODE         0           /* ends a chain, never a string's code */
+
+/* one entry for every literal prefix + suffix character */
+#define PAIR_TABLE_SIZE (FIRST_CODE << CHAR_BIT)
+
+/* input bytes between compression ratio checks, as in compress(1) */
+#define RATIO_WINDOW    10000
+
+#define INPUT_BLOCK     16384       /* bytes read from a file per fread */
+#define OUTPUT_BLOCK    16384       /* bytes written to a file per fwrite */
+
+#if ((MAX_CODE_LEN + CHAR_BIT) > 32) || (UINT_MAX < 0xFFFFFFFFUL)
+#error Dictionary keys must fit in a 32 bit unsigned int
+#endif
 
 /***************************************************************************
 *                            TYPE DEFINITIONS
 ***************************************************************************/
-/* node in dictionary tree */
-typedef struct dict_node_t
+/***************************************************************************
+* Node in dictionary.  A node's position in the arena is its code word, and
+* its string (prefix code + suffix character) is packed into a single key.
+* successor caches the last string found by extending this one, packed the
+* same way as a key: (successor code << CHAR_BIT) | appended char.
+***************************************************************************/
+typedef struct
 {
-    unsigned int codeWord;      /* code word for this entry */
-    unsigned char suffixChar;   /* last char in encoded string */
-    unsigned int prefixCode;    /* code for remaining chars in string */
-
-    /* pointer to child nodes */
-    struct dict_node_t *left;   /* child with < key */
-    struct dict_node_t *right;  /* child with >= key */
+    unsigned int key;           /* (prefix code << CHAR_BIT) | suffix char */
+    unsigned int next;          /* code word of next node in hash chain */
+    unsigned int successor;     /* last extension found, 0 if none */
 } dict_node_t;
 
 /***************************************************************************
-*                                CONSTANTS
+* Table slot.  A slot only holds a code word if it was written during the
+* dictionary's current generation, so the whole dictionary is emptied by
+* bumping the generation instead of clearing the tables.
+***************************************************************************/
+typedef struct
+{
+    unsigned int code;          /* code word stored in slot */
+    unsigned int generation;    /* dictionary generation that stored code */
+} dict_slot_t;
+
+/***************************************************************************
+* Dictionary.  Two character strings are looked up directly in pairTable,
+* longer strings are found through the hash table, and all nodes are carved
+* from the same arena.
 ***************************************************************************/
+typedef struct
+{
+    dict_slot_t *pairTable;     /* code word for each 2 character string */
+    dict_slot_t *hashTable;     /* code word at the head of each chain */
+    dict_node_t *nodes;         /* nodes indexed by (code word - FIRST_CODE) */
+    unsigned int generation;    /* current generation of table slots */
+    unsigned char hashBits;     /* hash table has 2^hashBits slots */
+} dictionary_t;
+
+/***************************************************************************
+* Standby dictionary for the LZW_FULL_STANDBY policy.  Strings written
+* while the active dictionary is nearly full are copied into it along with
+* any of their prefixes it doesn't have yet.
+***************************************************************************/
+typedef struct
+{
+    dictionary_t dictionary;    /* dictionary that replaces a full one */
+    unsigned int *codes;        /* standby code for each active code word */
+    unsigned int *stack;        /* active code words waiting to be copied */
+    unsigned int size;          /* number of string code words */
+    unsigned int nextCode;      /* next available standby code word */
+    unsigned int start;         /* active code count that starts copying */
+    unsigned int limit;         /* standby code count that stops copying */
+    int priming;                /* strings are being copied */
+} standby_t;
+
+/***************************************************************************
+* Encoder context, may be reused for any number of streams, which may be
+* files, buffers, or data pushed to the encoder a piece at a time.  Files
+* are read and written a block at a time through the context's own blocks,
+* and memory is read and written in place, so the encoding loop works the
+* same way for both.
+***************************************************************************/
+struct lzw_encoder_t
+{
+    dictionary_t dictionary;    /* string dictionary */
+    unsigned char maxCodeLen;   /* longest code word the encoder writes */
+    unsigned int resetThreshold;    /* % of input a window may encode to */
+    lzw_full_policy_t fullPolicy;   /* what to do when dictionary is full */
+    lru_t lru;                  /* code word use for LZW_FULL_LRU */
+    standby_t standby;          /* standby dictionary for LZW_FULL_STANDBY */
+
+    /* data being encoded */
+    FILE *fpIn;                 /* file being encoded, NULL for memory */
+    unsigned char inputBlock[INPUT_BLOCK];  /* data read from fpIn */
+    const unsigned char *input; /* inputBlock, or the caller's memory */
+    size_t inputNext;           /* next byte of input to encode */
+    size_t inputCount;          /* number of bytes in input */
+
+    /* encoded data */
+    FILE *fpOut;                /* file receiving encoded data, NULL for
+                                   memory */
+    unsigned char outputBlock[OUTPUT_BLOCK];    /* data to write to fpOut */
+    unsigned char *output;      /* outputBlock, or the caller's memory */
+    size_t outputCount;         /* number of bytes in output */
+    size_t outputSize;          /* number of bytes output can hold */
+    unsigned long bits;         /* bits not yet in output, oldest first */
+    unsigned int bitCount;      /* number of bits in the low end of bits */
+    code_order_t order;         /* packs orderLen bit code words */
+    unsigned char orderLen;     /* code word length order is for */
+    int error;                  /* errno of the first output failure */
+
+    /* where encoding stopped, so more input can be encoded */
+    int encoding;               /* code holds a string to be written */
+    unsigned int code;          /* code for current string */
+    unsigned char codeLen;      /* length of the current code */
+    unsigned int growCode;      /* GROW_CODE(codeLen) */
+    unsigned int nextCode;      /* next available code index */
+    unsigned long windowIn;     /* bytes read in ratio window */
+    unsigned long windowOut;    /* bits written in ratio window */
+    int trained;                /* dictionary has seen a window */
+
+#ifdef LZW_STATS
+    /* counted for the whole stream, across clears and standby switches */
+    unsigned long lookups;      /* searches for strings with string prefixes */
+    unsigned long successorHits;    /* searches satisfied by successor */
+#endif
+};
 
 /***************************************************************************
 *                                  MACROS
 ***************************************************************************/
+/* Fibonacci hash of a key; uses the high order bits of a 32 bit product */
+#define HASH(dict, key)     \
+    ((((unsigned long)(key) * 2654435761UL) & 0xFFFFFFFFUL) >> \
+    (32 - (dict)->hashBits))
+
+/* slots in a dictionary's hash table */
+#define HASH_SIZE(dict)     (1UL << (dict)->hashBits)
+
+/* node for a string code word */
+#define NODE(dict, code)    ((dict)->nodes[(code) - FIRST_CODE])
+
+/* standby code word for an active string code word, NO_CODE if none */
+#define STANDBY_CODE(standby, code) ((standby)->codes[(code) - FIRST_CODE])
+
+/* next byte of the data being encoded, EOF if there isn't one */
+#define GET_CHAR(encoder)   \
+    (((encoder)->inputNext < (encoder)->inputCount) ? \
+    (encoder)->input[(encoder)->inputNext++] : FillInput(encoder))
+
+/* put back the byte GET_CHAR just returned, it's still in the input */
+#define UNGET_CHAR(encoder) ((encoder)->inputNext--)
 
 /***************************************************************************
 *                            GLOBAL VARIABLES
@@ -71,362 +202,1581 @@ typedef struct dict_node_t
 *                               PROTOTYPES
 ***************************************************************************/
 
-/* dictionary tree node create/free */
-static dict_node_t *MakeNode(const unsigned int codeWord,
-    const unsigned int prefixCode, const unsigned char suffixChar);
-static void FreeTree(dict_node_t *node);
+/* dictionary create/free/empty */
+static int MakeDictionary(dictionary_t *dict, const unsigned char maxCodeLen);
+static void FreeDictionary(dictionary_t *dict);
+static void ResetDictionary(dictionary_t *dict);
 
-/* searches tree for matching dictionary entry */
-static dict_node_t *FindDictionaryEntry(dict_node_t *root,
-    const int unsigned prefixCode, const unsigned char c);
+/* searches/adds to dictionary */
+static unsigned int FindDictionaryEntry(lzw_encoder_t *encoder,
+    const unsigned int prefixCode, const unsigned char c);
+static void AddDictionaryEntry(dictionary_t *dict, const unsigned int code,
+    const unsigned int prefixCode, const unsigned char c);
+static unsigned int RemoveDictionaryEntry(dictionary_t *dict,
+    const unsigned int code);
+
+/* standby dictionary create/free/empty/use */
+static int MakeStandby(standby_t *standby, const unsigned char maxCodeLen);
+static void FreeStandby(standby_t *standby);
+static void ResetStandby(standby_t *standby);
+static void PrimeStandby(standby_t *standby, const dictionary_t *dict,
+    unsigned int code, const unsigned int nextCode);
+static unsigned int SwitchToStandby(dictionary_t *dict, standby_t *standby);
 
 /* makes key from prefix code and character */
 static unsigned int MakeKey(const unsigned int prefixCode,
     const unsigned char suffixChar);
 
+/* encode a stream, possibly a piece at a time */
+static int Encode(lzw_encoder_t *encoder);
+static void StartEncoding(lzw_encoder_t *encoder);
+static void EncodeInput(lzw_encoder_t *encoder);
+static int FinishEncoding(lzw_encoder_t *encoder);
+static int OutputStatus(lzw_encoder_t *encoder);
+
+/* read data to encode */
+static int FillInput(lzw_encoder_t *encoder);
+
 /* write encoded data */
-static int PutCodeWord(bit_file_t *bfpOut, int code,
+static void PutByte(lzw_encoder_t *encoder, const unsigned char byte);
+static int FlushOutput(lzw_encoder_t *encoder);
+static void PutCodeWord(lzw_encoder_t *encoder, const unsigned int code,
     const unsigned char codeLen);
+static void PutClearCode(lzw_encoder_t *encoder, unsigned char *codeLen,
+    const unsigned char maxCodeLen);
+
+/* encode with a dictionary that no longer changes */
+static int EncodeFrozen(lzw_encoder_t *encoder, unsigned int *code,
+    const unsigned char codeLen, unsigned long *windowIn,
+    unsigned long *windowOut);
 
 /***************************************************************************
 *                                FUNCTIONS
 ***************************************************************************/
 
+/***************************************************************************
+*   Function   : LZWCreateEncoder
+*   Description: This routine allocates an encoder context that may be
+*                used to encode any number of files.  All of the memory
+*                the encoder needs is allocated here, so reusing a context
+*                avoids allocating a dictionary for each file.  The size
+*                of the dictionary is set by the maximum code word length.
+*   Parameters : maxCodeLen - maximum code word length (LZW_MIN_CODE_LEN
+*                             to LZW_MAX_CODE_LEN)
+*   Effects    : Memory is allocated for the encoder and its dictionary
+*   Returned   : Pointer to the new encoder, NULL on failure.  errno will
+*                be set in the event of a failure.
+***************************************************************************/
+lzw_encoder_t *LZWCreateEncoder(const unsigned int maxCodeLen)
+{
+    lzw_encoder_t *encoder;
+
+    if ((maxCodeLen < MIN_CODE_LEN) || (maxCodeLen > MAX_CODE_LEN))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    encoder = malloc(sizeof(lzw_encoder_t));
+
+    if (NULL == encoder)
+    {
+        return NULL;
+    }
+
+    if (0 != MakeDictionary(&encoder->dictionary, maxCodeLen))
+    {
+        free(encoder);
+        return NULL;
+    }
+
+    encoder->maxCodeLen = maxCodeLen;
+    encoder->resetThreshold = 0;
+    encoder->fullPolicy = LZW_FULL_RESET;
+    encoder->lru.codes = NULL;      /* only allocated if it will be used */
+    encoder->standby.codes = NULL;
+    encoder->standby.dictionary.pairTable = NULL;
+    encoder->fpOut = NULL;          /* nothing to push to until started */
+    encoder->encoding = 0;
+    return encoder;
+}
+
+/***************************************************************************
+*   Function   : LZWDestroyEncoder
+*   Description: This routine frees an encoder context created by
+*                LZWCreateEncoder.
+*   Parameters : encoder - encoder to free (may be NULL)
+*   Effects    : Memory allocated for the encoder is freed
+*   Returned   : None
+***************************************************************************/
+void LZWDestroyEncoder(lzw_encoder_t *encoder)
+{
+    if (NULL == encoder)
+    {
+        return;
+    }
+
+    FreeDictionary(&encoder->dictionary);
+    FreeLRU(&encoder->lru);
+    FreeStandby(&encoder->standby);
+    free(encoder);
+}
+
+/***************************************************************************
+*   Function   : LZWEncoderSetResetThreshold
+*   Description: This routine sets the compression ratio that triggers a
+*                dictionary reset.  The encoder measures its output over
+*                windows of RATIO_WINDOW input bytes.  If a window encoded
+*                by a dictionary that has already seen a full window comes
+*                out larger than threshold percent of its input, the
+*                dictionary is emptied and a clear code is written, just as
+*                if the dictionary had filled up.
+*   Parameters : encoder - encoder context to configure
+*                threshold - percentage of input size (1 to 100), or 0 to
+*                            only reset when the dictionary is full
+*   Effects    : Applies to files encoded with encoder from now on
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+int LZWEncoderSetResetThreshold(lzw_encoder_t *encoder,
+    const unsigned int threshold)
+{
+    if ((NULL == encoder) || (threshold > 100))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    encoder->resetThreshold = threshold;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : LZWEncoderSetFullPolicy
+*   Description: This routine selects what the encoder does once every code
+*                word has been assigned.  LZW_FULL_RESET writes a clear code
+*                and starts over with an empty dictionary.  LZW_FULL_LRU
+*                keeps the dictionary and reassigns the code word of a
+*                string that hasn't been used recently.  LZW_FULL_STANDBY
+*                switches to a standby dictionary holding the strings used
+*                while the full one was filling up.  LZW_FULL_FREEZE keeps
+*                the dictionary as it is until the reset threshold calls
+*                for a clear.  The policy is recorded
+*                in the encoded data, so the decoder follows it without
+*                being told.
+*   Parameters : encoder - encoder context to configure
+*                policy - policy to follow when the dictionary is full
+*   Effects    : Applies to files encoded with encoder from now on.  Memory
+*                for tracking code word use or for the standby dictionary
+*                is allocated the first time LZW_FULL_LRU or
+*                LZW_FULL_STANDBY is selected.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  errno is EBUSY if the encoder is in
+*                the middle of a stream started with LZWEncoderStart,
+*                whose header already holds the policy.
+***************************************************************************/
+int LZWEncoderSetFullPolicy(lzw_encoder_t *encoder,
+    const lzw_full_policy_t policy)
+{
+    if (NULL == encoder)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (NULL != encoder->fpOut)
+    {
+        /* the stream being pushed must keep its policy until it ends */
+        errno = EBUSY;
+        return -1;
+    }
+
+    switch (policy)
+    {
+        case LZW_FULL_RESET:
+            break;
+
+        case LZW_FULL_LRU:
+            if ((NULL == encoder->lru.codes) &&
+                (0 != MakeLRU(&encoder->lru, encoder->maxCodeLen)))
+            {
+                return -1;
+            }
+            break;
+
+        case LZW_FULL_STANDBY:
+            if ((NULL == encoder->standby.codes) &&
+                (0 != MakeStandby(&encoder->standby, encoder->maxCodeLen)))
+            {
+                return -1;
+            }
+            break;
+
+        case LZW_FULL_FREEZE:
+            break;
+
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+
+    encoder->fullPolicy = policy;
+    return 0;
+}
+
 /***************************************************************************
 *   Function   : LZWEncodeFile
-*   Description: This routine reads an input file 1 character at a time and
-*                writes out an LZW encoded version of that file.
+*   Description: This routine writes out an LZW encoded version of an
+*                input file using a temporary encoder context with
+*                LZW_DEFAULT_CODE_LEN bit maximum code words.
 *   Parameters : fpIn - pointer to the open binary file to encode
 *                fpOut - pointer to the open binary file to write encoded
 *                       output
-*   Effects    : fpIn is encoded using the LZW algorithm with CODE_LEN codes
-*                and written to fpOut.  Neither file is closed after exit.
+*   Effects    : fpIn is encoded using the LZW algorithm and written to
+*                fpOut, as LZWEncoderEncodeFile writes it.  Neither file is
+*                closed after exit.
 *   Returned   : 0 for success, -1 for failure.  errno will be set in the
 *                event of a failure.
 ***************************************************************************/
 int LZWEncodeFile(FILE *fpIn, FILE *fpOut)
 {
-    bit_file_t *bfpOut;                 /* encoded output */
-
-    unsigned int code;                  /* code for current string */
-    unsigned char currentCodeLen;       /* length of the current code */
-    unsigned int nextCode;              /* next available code index */
-    int c;                              /* character to add to string */
+    lzw_encoder_t *encoder;
+    int result;
 
-    dict_node_t *dictRoot;              /* root of dictionary tree */
-    dict_node_t *node;                  /* node of dictionary tree */
+    encoder = LZWCreateEncoder(LZW_DEFAULT_CODE_LEN);
 
-    /* validate arguments */
-    if ((NULL == fpIn) || (NULL == fpOut))
+    if (NULL == encoder)
     {
-        errno = ENOENT;
+        perror("Allocating Encoder");
         return -1;
     }
 
-    /* convert output file to bitfile */
-    bfpOut = MakeBitFile(fpOut, BF_WRITE);
+    result = LZWEncoderEncodeFile(encoder, fpIn, fpOut);
+    LZWDestroyEncoder(encoder);
 
-    if (NULL == bfpOut)
+    return result;
+}
+
+/***************************************************************************
+*   Function   : LZWEncoderEncodeFile
+*   Description: This routine reads an input file a block at a time and
+*                writes out an LZW encoded version of that file a block at
+*                a time.
+*   Parameters : encoder - encoder context to use
+*                fpIn - pointer to the open binary file to encode
+*                fpOut - pointer to the open binary file to write encoded
+*                       output
+*   Effects    : fpIn is encoded using the LZW algorithm and written to
+*                fpOut.  The encoded data starts with a header holding the
+*                encoder's maximum code word length and full dictionary
+*                policy.  Code words start at MIN_CODE_LEN bits and grow up
+*                to that length.  Neither file is closed after exit.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+int LZWEncoderEncodeFile(lzw_encoder_t *encoder, FILE *fpIn, FILE *fpOut)
+{
+    int result;
+
+    /* validate arguments */
+    if ((NULL == encoder) || (NULL == fpIn) || (NULL == fpOut))
     {
-        perror("Making Output File a BitFile");
+        errno = ENOENT;
         return -1;
     }
 
-    /* initialize dictionary as empty */
-    dictRoot = NULL;
+    encoder->fpIn = fpIn;
+    encoder->input = encoder->inputBlock;
+    encoder->inputNext = 0;
+    encoder->inputCount = 0;
 
-    /* start MIN_CODE_LEN bit code words */
-    currentCodeLen = MIN_CODE_LEN;
+    encoder->fpOut = fpOut;
+    encoder->output = encoder->outputBlock;
+    encoder->outputCount = 0;
+    encoder->outputSize = OUTPUT_BLOCK;
+
+    result = Encode(encoder);
+    encoder->fpOut = NULL;      /* not pushing data to fpOut */
 
-    nextCode = FIRST_CODE;  /* code for next (first) string */
+    return result;
+}
 
-    /* now start the actual encoding process */
+/***************************************************************************
+*   Function   : LZWEncodeBuffer
+*   Description: This routine LZW encodes data in memory using a temporary
+*                encoder context with LZW_DEFAULT_CODE_LEN bit maximum code
+*                words.
+*   Parameters : in - data to encode
+*                inLen - number of bytes of data to encode
+*                out - memory to write encoded data to
+*                outCap - number of bytes out can hold.
+*                         LZWCompressBound(inLen) is always enough.
+*                outLen - set to the number of bytes of encoded data
+*   Effects    : in is encoded into out
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  errno is ENOBUFS if the encoded data
+*                doesn't fit in out.
+***************************************************************************/
+int LZWEncodeBuffer(const void *in, size_t inLen, void *out, size_t outCap,
+    size_t *outLen)
+{
+    lzw_encoder_t *encoder;
+    int result;
 
-    c = fgetc(fpIn);
+    encoder = LZWCreateEncoder(LZW_DEFAULT_CODE_LEN);
 
-    if (EOF == c)
-    {
-        return -1;      /* empty file */
-    }
-    else
+    if (NULL == encoder)
     {
-        code = c;       /* start with code string = first character */
+        return -1;
     }
 
-    /* create a tree root from 1st 2 character string */
-    if ((c = fgetc(fpIn)) != EOF)
-    {
-        /* special case for NULL root */
-        dictRoot = MakeNode(nextCode, code, c);
+    result = LZWEncoderEncodeBuffer(encoder, in, inLen, out, outCap, outLen);
+    LZWDestroyEncoder(encoder);
 
-        if (NULL == dictRoot)
-        {
-            perror("Making Dictionary Root");
-            BitFileToFILE(bfpOut);
-            return -1;
-        }
-        
-        nextCode++;
+    return result;
+}
 
-        /* write code for 1st char */
-        PutCodeWord(bfpOut, code, currentCodeLen);
+/***************************************************************************
+*   Function   : LZWEncoderEncodeBuffer
+*   Description: This routine LZW encodes data in memory.  The data is
+*                read straight from in and code words are packed straight
+*                into out, so stdio isn't used.
+*   Parameters : encoder - encoder context to use
+*                in - data to encode
+*                inLen - number of bytes of data to encode
+*                out - memory to write encoded data to
+*                outCap - number of bytes out can hold.
+*                         LZWCompressBound(inLen) is always enough.
+*                outLen - set to the number of bytes of encoded data
+*   Effects    : in is encoded into out, the same way LZWEncoderEncodeFile
+*                would encode it.  Empty input is encoded as nothing.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  errno is ENOBUFS if the encoded data
+*                doesn't fit in out, and *outLen is then outCap.
+***************************************************************************/
+int LZWEncoderEncodeBuffer(lzw_encoder_t *encoder, const void *in,
+    size_t inLen, void *out, size_t outCap, size_t *outLen)
+{
+    int result;
 
-        /* new code is just 2nd char */
-        code = c;
+    /* validate arguments */
+    if ((NULL == encoder) || ((NULL == in) && (0 != inLen)) ||
+        ((NULL == out) && (0 != outCap)) || (NULL == outLen))
+    {
+        errno = ENOENT;
+        return -1;
     }
 
-    /* now encode normally */
-    while ((c = fgetc(fpIn)) != EOF)
-    {
-        /* look for code + c in the dictionary */
-        node = FindDictionaryEntry(dictRoot, code, c);
+    *outLen = 0;
 
-        if ((node->prefixCode == code) &&
-            (node->suffixChar == c))
-        {
-            /* code + c is in the dictionary, make it's code the new code */
-            code = node->codeWord;
-        }
-        else
-        {
-            /* code + c is not in the dictionary, add it if there's room */
-            if (nextCode < MAX_CODES)
-            {
-                dict_node_t *tmp;
+    if (0 == inLen)
+    {
+        /* empty input */
+        return 0;
+    }
 
-                tmp = MakeNode(nextCode, code, c);
+    encoder->fpIn = NULL;
+    encoder->input = in;
+    encoder->inputNext = 0;
+    encoder->inputCount = inLen;
 
-                if (NULL == dictRoot)
-                {
-                    perror("Making Dictionary Node");
-                    FreeTree(dictRoot);
-                    BitFileToFILE(bfpOut);
-                    return -1;
-                }
+    encoder->fpOut = NULL;
+    encoder->output = out;
+    encoder->outputCount = 0;
+    encoder->outputSize = outCap;
 
-                nextCode++;
+    result = Encode(encoder);
+    *outLen = encoder->outputCount;
 
-                if (MakeKey(code, c) <
-                    MakeKey(node->prefixCode, node->suffixChar))
-                {
-                    node->left = tmp;
-                }
-                else
-                {
-                    node->right = tmp;
-                }
-            }
-            else
-            {
-                fprintf(stderr, "Error: Dictionary Full\n");
-            }
+    return result;
+}
 
-            /* are we using enough bits to write out this code word? */
-            while ((code >= (CURRENT_MAX_CODES(currentCodeLen) - 1)) &&
-                (currentCodeLen < MAX_CODE_LEN))
-            {
-                /* mark need for bigger code word with all ones */
-                PutCodeWord(bfpOut, (CURRENT_MAX_CODES(currentCodeLen) - 1),
-                    currentCodeLen);
-                currentCodeLen++;
-            }
+/***************************************************************************
+*   Function   : LZWCompressBound
+*   Description: This routine returns the most bytes that LZW encoding
+*                inLen bytes can produce, for any maximum code word length
+*                and policy.  No string code word can be larger than the
+*                number of strings, which is at most inLen + FIRST_CODE,
+*                so every code word fits in W bits, where W is the length
+*                of that number, and there are at most inLen of them.
+*                Code word length increase markers, clear codes, and
+*                switch codes add less than half a bit per input byte,
+*                because clearing or switching requires a full dictionary
+*                or a RATIO_WINDOW of input.  The header, the last byte's
+*                padding, and the first dictionary's length increase
+*                markers make up the rest.
+*   Parameters : inLen - number of bytes to be encoded
+*   Effects    : None
+*   Returned   : Size of a buffer that will hold any encoding of inLen
+*                bytes.
+***************************************************************************/
+size_t LZWCompressBound(size_t inLen)
+{
+    unsigned int bits;          /* bits per input byte, times 2 */
+    unsigned char codeLen;
 
-            /* write out code for the string before c was added */
-            PutCodeWord(bfpOut, code, currentCodeLen);
+    codeLen = MIN_CODE_LEN;
 
-            /* new code is just c */
-            code = c;
-        }
+    while ((codeLen < MAX_CODE_LEN) &&
+        ((inLen + FIRST_CODE) > (GROW_CODE(codeLen) - 1)))
+    {
+        codeLen++;
     }
 
-    /* no more input.  write out last of the code. */
-    PutCodeWord(bfpOut, code, currentCodeLen);
+    /* code words plus half a bit of markers for each byte */
+    bits = (2 * codeLen) + 1;
+
+    return ((inLen / 16) * bits) + ((((inLen % 16) * bits) + 15) / 16) +
+        (MAX_CODE_LEN * MAX_CODE_LEN / CHAR_BIT) + 2;
+}
+
+/***************************************************************************
+*   Function   : LZWEncoderStart
+*   Description: This routine starts a stream that will be pushed to the
+*                encoder a piece at a time with LZWEncoderUpdate and ended
+*                with LZWEncoderFinish.  Any stream the encoder was in the
+*                middle of is abandoned.
+*   Parameters : encoder - encoder context to use
+*                fpOut - pointer to the open binary file to write encoded
+*                       output
+*   Effects    : The encoder is ready to encode a new stream into fpOut.
+*                fpOut isn't closed by the encoder.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+int LZWEncoderStart(lzw_encoder_t *encoder, FILE *fpOut)
+{
+    /* validate arguments */
+    if ((NULL == encoder) || (NULL == fpOut))
+    {
+        errno = ENOENT;
+        return -1;
+    }
 
-    /* we've encoded everything, free bitfile structure */
-    BitFileToFILE(bfpOut);
+    encoder->fpIn = NULL;       /* input only comes from LZWEncoderUpdate */
+    encoder->input = NULL;
+    encoder->inputNext = 0;
+    encoder->inputCount = 0;
 
-    /* free the dictionary */
-    FreeTree(dictRoot);
+    encoder->fpOut = fpOut;
+    encoder->output = encoder->outputBlock;
+    encoder->outputCount = 0;
+    encoder->outputSize = OUTPUT_BLOCK;
 
+    StartEncoding(encoder);
     return 0;
 }
 
 /***************************************************************************
-*   Function   : MakeKey
-*   Description: This routine creates a simple key from a prefix code and
-*                an appended character.  The key may be used to establish
-*                an order when building/searching a dictionary tree.
-*   Parameters : prefixCode - code for all but the last character of a
-*                             string.
-*                suffixChar - the last character of a string
-*   Effects    : None
-*   Returned   : Key built from string represented as a prefix + char.  Key
-*                format is {ms nibble of c} + prefix + {ls nibble of c}
+*   Function   : LZWEncoderUpdate
+*   Description: This routine encodes the next piece of a stream started
+*                with LZWEncoderStart.  Pieces may be any size.  The string
+*                that a piece ends in may be extended by the next piece,
+*                so its code word is held in the encoder, along with any
+*                bits that don't fill a byte yet.
+*   Parameters : encoder - encoder context that was started
+*                in - next piece of the data to encode
+*                inLen - number of bytes in the piece
+*   Effects    : in is encoded, and encoded data is written to the
+*                started stream's file a block at a time.  in isn't used
+*                after this routine returns.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  A write failure is reported by every
+*                call until the stream is restarted.
 ***************************************************************************/
-static unsigned int MakeKey(const unsigned int prefixCode,
-    const unsigned char suffixChar)
+int LZWEncoderUpdate(lzw_encoder_t *encoder, const void *in, size_t inLen)
 {
-    unsigned int key;
+    /* validate arguments */
+    if ((NULL == encoder) || (NULL == encoder->fpOut) ||
+        ((NULL == in) && (0 != inLen)))
+    {
+        errno = ENOENT;
+        return -1;
+    }
 
-    /* position ms nibble */
-    key = suffixChar & 0xF0;
-    key <<= MAX_CODE_LEN;
+    encoder->input = in;
+    encoder->inputNext = 0;
+    encoder->inputCount = inLen;
 
-    /* include prefix code */
-    key |= (prefixCode << 4);
+    EncodeInput(encoder);
 
-    /* inclulde ls nibble */
-    key |= (suffixChar & 0x0F);
+    encoder->input = NULL;
+    encoder->inputCount = 0;
 
-    return key;
+    return OutputStatus(encoder);
 }
 
 /***************************************************************************
-*   Function   : MakeNode
-*   Description: This routine creates and initializes a dictionary entry
-*                for a string and the code word that encodes it.
-*   Parameters : codeWord - code word used to encode the string prefixCode +
-*                           suffixChar
-*                prefixCode - code for all but the last character of a
-*                             string.
-*                suffixChar - the last character of a string
-*   Effects    : Node is allocated for new dictionary entry
-*   Returned   : Pointer to newly allocated node or NULL on error.
-*                errno will be set on an error.
+*   Function   : LZWEncoderFlush
+*   Description: This routine writes out all of the encoded data that the
+*                started stream can have so far.  The code word for the
+*                string that the last piece ended in and the bits of a
+*                partial byte can't be written without ending the stream,
+*                so they stay in the encoder.
+*   Parameters : encoder - encoder context that was started
+*   Effects    : Buffered encoded data is written to the started stream's
+*                file, and the file is flushed.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
 ***************************************************************************/
-static dict_node_t *MakeNode(const unsigned int codeWord,
-    const unsigned int prefixCode, const unsigned char suffixChar)
+int LZWEncoderFlush(lzw_encoder_t *encoder)
 {
-    dict_node_t *node;
+    /* validate arguments */
+    if ((NULL == encoder) || (NULL == encoder->fpOut))
+    {
+        errno = ENOENT;
+        return -1;
+    }
 
-    node = malloc(sizeof(dict_node_t));
+    FlushOutput(encoder);
 
-    if (NULL != node)
+    if ((0 == encoder->error) && (EOF == fflush(encoder->fpOut)))
     {
-        node->codeWord = codeWord;
-        node->prefixCode = prefixCode;
-        node->suffixChar = suffixChar;
-
-        node->left = NULL;
-        node->right = NULL;
+        encoder->error = (0 != errno) ? errno : EIO;
     }
 
-    return node;
+    return OutputStatus(encoder);
 }
 
 /***************************************************************************
-*   Function   : FreeTree
-*   Description: This routine will free all nodes of a tree rooted at the
-*                node past as a parameter.
-*   Parameters : node - root of tree to free
-*   Effects    : frees allocated tree node from initial parameter down.
-*   Returned   : none
+*   Function   : LZWEncoderFinish
+*   Description: This routine ends a stream started with LZWEncoderStart.
+*                The code word for the string that the last piece ended in
+*                is written, and the last byte is padded with zeros.
+*   Parameters : encoder - encoder context that was started
+*   Effects    : The rest of the encoded data is written to the started
+*                stream's file.  The encoder may then be used for another
+*                stream.  A stream with no data is encoded as nothing.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
 ***************************************************************************/
-static void FreeTree(dict_node_t *node)
+int LZWEncoderFinish(lzw_encoder_t *encoder)
 {
-    if (NULL == node)
-    {
-        /* nothing to free */
-        return;
-    }
+    int result;
 
-    /* free left branch */
-    if (node->left != NULL)
+    /* validate arguments */
+    if ((NULL == encoder) || (NULL == encoder->fpOut))
     {
-        FreeTree(node->left);
+        errno = ENOENT;
+        return -1;
     }
 
-    /* free right branch */
-    if (node->right != NULL)
+    result = FinishEncoding(encoder);
+    encoder->fpOut = NULL;      /* the stream must be started again */
+
+    return result;
+}
+
+/***************************************************************************
+*   Function   : Encode
+*   Description: This routine encodes all of the encoder's input.
+*   Parameters : encoder - encoder context with its input and output ready
+*   Effects    : The input is encoded and written to the encoder's output
+*   Returned   : 0 for success, -1 for failure (including empty input).
+*                errno will be set in the event of an output failure.
+***************************************************************************/
+static int Encode(lzw_encoder_t *encoder)
+{
+    StartEncoding(encoder);
+    EncodeInput(encoder);
+
+    if (!encoder->encoding)
     {
-        FreeTree(node->right);
+        return -1;      /* empty file */
     }
 
-    /* free root */
-    free(node);
+    return FinishEncoding(encoder);
 }
 
 /***************************************************************************
-*   Function   : FindDictionaryEntry
-*   Description: This routine searches the dictionary tree for an entry
-*                with a matching string (prefix code + suffix character).
-*                If one isn't found, the parent node for that string is
-*                returned.
-*   Parameters : prefixCode - code for the prefix of string
-*                c - last character in string
-*   Effects    : None
-*   Returned   : If string is in dictionary, pointer to node containing
-*                string, otherwise pointer to suitable parent node.  NULL
-*                is returned for an empty tree.
+*   Function   : StartEncoding
+*   Description: This routine readies an encoder to encode a new stream.
+*   Parameters : encoder - encoder context to ready
+*   Effects    : The encoder's dictionary is emptied in constant time, and
+*                it starts writing MIN_CODE_LEN bit code words.  No output
+*                is written until there's input.
+*   Returned   : None
 ***************************************************************************/
-static dict_node_t *FindDictionaryEntry(dict_node_t *root,
-    const int unsigned prefixCode, const unsigned char c)
+static void StartEncoding(lzw_encoder_t *encoder)
 {
-    unsigned int searchKey, key;
+    /* start with an empty dictionary */
+    ResetDictionary(&encoder->dictionary);
 
-    if (NULL == root)
+    if (LZW_FULL_LRU == encoder->fullPolicy)
     {
-        return NULL;
+        ResetLRU(&encoder->lru);
     }
 
-    searchKey = MakeKey(prefixCode, c);     /* key of string to find */
-
-    while (1)
+    if (LZW_FULL_STANDBY == encoder->fullPolicy)
     {
-        /* key of current node */
-        key = MakeKey(root->prefixCode, root->suffixChar);
+        ResetStandby(&encoder->standby);
+    }
 
-        if (key == searchKey)
-        {
-            /* current node contains string */
-            return root;
-        }
-        else if (searchKey < key)
-        {
-            if (NULL != root->left)
-            {
-                /* check left branch for string */
-                root = root->left;
-            }
-            else
-            {
-                /* string isn't in tree, it can be added as a left child */
-                return root;
-            }
-        }
+    encoder->bits = 0;
+    encoder->bitCount = 0;
+    encoder->orderLen = 0;          /* no code word length yet */
+    encoder->error = 0;
+
+    /* start MIN_CODE_LEN bit code words */
+    encoder->codeLen = MIN_CODE_LEN;
+    encoder->growCode = GROW_CODE(MIN_CODE_LEN);
+
+    encoder->nextCode = FIRST_CODE;     /* code for next (first) string */
+
+    encoder->windowIn = 0;
+    encoder->windowOut = 0;
+    encoder->trained = 0;
+    encoder->encoding = 0;
+
+#ifdef LZW_STATS
+    encoder->lookups = 0;
+    encoder->successorHits = 0;
+#endif
+}
+
+/***************************************************************************
+*   Function   : EncodeInput
+*   Description: This routine reads the encoder's input 1 character at a
+*                time and writes out an LZW encoded version of it.  The
+*                string that the input ends in may be extended by more
+*                input, so it isn't written.  Everything needed to
+*                continue is kept in the encoder, so more input may be
+*                encoded by calling this routine again.
+*   Parameters : encoder - encoder context with its input and output ready
+*   Effects    : The input is encoded using the LZW algorithm and written
+*                to the encoder's output.  The encoder's dictionary is
+*                emptied (after writing a clear code) each time its
+*                compression ratio drops below the encoder's reset
+*                threshold or it fills up under the LZW_FULL_RESET policy.
+*                Under the LZW_FULL_STANDBY policy a full dictionary is
+*                replaced by the standby dictionary after writing a clear
+*                code and a SWITCH_CODE.  Under the LZW_FULL_FREEZE policy
+*                a full dictionary is only read from, using EncodeFrozen.
+*   Returned   : None
+***************************************************************************/
+static void EncodeInput(lzw_encoder_t *encoder)
+{
+    unsigned int code;                  /* code for current string */
+    unsigned char currentCodeLen;       /* length of the current code */
+    unsigned int growCode;              /* GROW_CODE(currentCodeLen) */
+    unsigned int nextCode;              /* next available code index */
+    int c;                              /* character to add to string */
+
+    unsigned char maxCodeLen;           /* longest code word */
+    unsigned int clearCode;             /* all ones at maxCodeLen bits */
+
+    dictionary_t *dictionary;           /* string dictionary */
+    unsigned int entry;                 /* code word of dictionary entry */
+    int clear;                          /* start a new dictionary */
+    lru_t *lru;                         /* code word use, NULL if unused */
+    standby_t *standby;                 /* standby, NULL if unused */
+
+    unsigned long windowIn;             /* bytes read in ratio window */
+    unsigned long windowOut;            /* bits written in ratio window */
+    int trained;                        /* dictionary has seen a window */
+
+    maxCodeLen = encoder->maxCodeLen;
+    clearCode = CLEAR_CODE(maxCodeLen);
+    dictionary = &encoder->dictionary;
+    lru = (LZW_FULL_LRU == encoder->fullPolicy) ? &encoder->lru : NULL;
+    standby =
+        (LZW_FULL_STANDBY == encoder->fullPolicy) ? &encoder->standby : NULL;
+
+    if (!encoder->encoding)
+    {
+        /* now start the actual encoding process */
+        c = GET_CHAR(encoder);
+
+        if (EOF == c)
+        {
+            return;     /* no input yet */
+        }
+
+        encoder->code = c;  /* start with code string = first character */
+        encoder->encoding = 1;
+
+        /* tell the decoder how the data was encoded */
+        PutByte(encoder, MAKE_HEADER(maxCodeLen, encoder->fullPolicy));
+    }
+
+    /* pick up where the last call left off */
+    code = encoder->code;
+    currentCodeLen = encoder->codeLen;
+    growCode = encoder->growCode;
+    nextCode = encoder->nextCode;
+    windowIn = encoder->windowIn;
+    windowOut = encoder->windowOut;
+    trained = encoder->trained;
+
+    /* a frozen dictionary picks up in its own loop */
+    c = 0;
+
+    if ((nextCode >= clearCode) && (LZW_FULL_FREEZE == encoder->fullPolicy))
+    {
+        c = EncodeFrozen(encoder, &code, currentCodeLen, &windowIn,
+            &windowOut);
+    }
+
+    while ((EOF != c) && ((c = GET_CHAR(encoder)) != EOF))
+    {
+        windowIn++;
+
+        /* look for code + c in the dictionary */
+        entry = FindDictionaryEntry(encoder, code, c);
+
+        if (NO_CODE != entry)
+        {
+            /* code + c is in the dictionary, make it's code the new code */
+            code = entry;
+        }
         else
         {
-            if (NULL != root->right)
+            /* code + c is not in the dictionary */
+
+            /* are we using enough bits to write out this code word? */
+            while (code >= growCode)
             {
-                /* check right branch for string */
-                root = root->right;
+                /* mark need for bigger code word with all ones */
+                PutCodeWord(encoder, growCode, currentCodeLen);
+                windowOut += currentCodeLen;
+                currentCodeLen++;
+                growCode = GROW_CODE(currentCodeLen);
+            }
+
+            /* write out code for the string before c was added */
+            PutCodeWord(encoder, code, currentCodeLen);
+            windowOut += currentCodeLen;
+
+            if (NULL != lru)
+            {
+                LRUUseCode(lru, code);
+            }
+
+            if (NULL != standby)
+            {
+                PrimeStandby(standby, dictionary, code, nextCode);
+            }
+
+            /* start over if the dictionary is full and can't be replaced */
+            clear = (nextCode >= clearCode) &&
+                (LZW_FULL_RESET == encoder->fullPolicy);
+
+            if (windowIn >= RATIO_WINDOW)
+            {
+                /* or if a trained dictionary compressed this window poorly */
+                if (trained && (0 != encoder->resetThreshold) &&
+                    ((windowOut * 100) >
+                    (windowIn * CHAR_BIT * encoder->resetThreshold)))
+                {
+                    clear = 1;
+                }
+
+                windowIn = 0;
+                windowOut = 0;
+                trained = 1;
+            }
+
+            if (clear)
+            {
+                /* tell the decoder to start over */
+                PutClearCode(encoder, &currentCodeLen, maxCodeLen);
+
+                ResetDictionary(dictionary);
+                nextCode = FIRST_CODE;
+                currentCodeLen = MIN_CODE_LEN;
+                growCode = GROW_CODE(currentCodeLen);
+
+                if (NULL != lru)
+                {
+                    ResetLRU(lru);
+                }
+
+                if (NULL != standby)
+                {
+                    ResetStandby(standby);
+                }
+
+                windowIn = 0;
+                windowOut = 0;
+                trained = 0;
+            }
+            else if ((nextCode >= clearCode) && (NULL != standby))
+            {
+                /* tell the decoder to switch to the standby dictionary */
+                PutClearCode(encoder, &currentCodeLen, maxCodeLen);
+                PutCodeWord(encoder, SWITCH_CODE, MIN_CODE_LEN);
+                growCode = clearCode;
+                nextCode = SwitchToStandby(dictionary, standby);
             }
             else
             {
-                /* string isn't in tree, it can be added as a right child */
-                return root;
+                if (nextCode < clearCode)
+                {
+                    entry = nextCode;
+                    nextCode++;
+                }
+                else if (NULL != lru)
+                {
+                    /* full, recycle the least recently used code word */
+                    entry = LRUFindVictim(lru, code);
+
+                    if (clearCode != entry)
+                    {
+                        LRURemoveCode(lru,
+                            RemoveDictionaryEntry(dictionary, entry));
+                    }
+                }
+                else
+                {
+                    /* full and frozen, nothing is added */
+                    entry = clearCode;
+                }
+
+                if (clearCode != entry)
+                {
+                    /* add code + c to the dictionary */
+                    AddDictionaryEntry(dictionary, entry, code, c);
+
+                    if (NULL != lru)
+                    {
+                        LRUAddCode(lru, entry, code);
+                    }
+                }
+            }
+
+            /* new code is just c */
+            code = c;
+
+            if ((nextCode >= clearCode) &&
+                (LZW_FULL_FREEZE == encoder->fullPolicy))
+            {
+                /* every code word written from now on may need all bits */
+                while (currentCodeLen < maxCodeLen)
+                {
+                    PutCodeWord(encoder, growCode, currentCodeLen);
+                    windowOut += currentCodeLen;
+                    currentCodeLen++;
+                    growCode = GROW_CODE(currentCodeLen);
+                }
+
+                /* nothing changes until the next ratio check */
+                if (EOF == EncodeFrozen(encoder, &code, currentCodeLen,
+                    &windowIn, &windowOut))
+                {
+                    break;
+                }
             }
         }
     }
+
+    encoder->code = code;
+    encoder->codeLen = currentCodeLen;
+    encoder->growCode = growCode;
+    encoder->nextCode = nextCode;
+    encoder->windowIn = windowIn;
+    encoder->windowOut = windowOut;
+    encoder->trained = trained;
+}
+
+/***************************************************************************
+*   Function   : FinishEncoding
+*   Description: This routine ends the stream an encoder is encoding.  The
+*                code word for the string that the input ended in is
+*                written, after any code word length increase markers it
+*                needs, and the last byte is padded with zeros.
+*   Parameters : encoder - encoder context to finish
+*   Effects    : The rest of the encoded data is written to the encoder's
+*                output, and output files are written.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int FinishEncoding(lzw_encoder_t *encoder)
+{
+    if (encoder->encoding)
+    {
+        /* are we using enough bits to write out the last code word? */
+        while (encoder->code >= encoder->growCode)
+        {
+            PutCodeWord(encoder, encoder->growCode, encoder->codeLen);
+            encoder->codeLen++;
+            encoder->growCode = GROW_CODE(encoder->codeLen);
+        }
+
+        /* no more input.  write out last of the code. */
+        PutCodeWord(encoder, encoder->code, encoder->codeLen);
+        encoder->encoding = 0;
+
+#ifdef LZW_STATS
+        fprintf(stderr, "Successor cache: %lu hits / %lu lookups (%.1f%%)\n",
+            encoder->successorHits, encoder->lookups,
+            encoder->lookups ?
+            (100.0 * encoder->successorHits) / encoder->lookups : 0.0);
+#endif
+    }
+
+    /* we've encoded everything, pad the last byte with zeros */
+    if (0 != encoder->bitCount)
+    {
+        PutByte(encoder,
+            (encoder->bits << (CHAR_BIT - encoder->bitCount)) & UCHAR_MAX);
+        encoder->bitCount = 0;
+    }
+
+    if (NULL != encoder->fpOut)
+    {
+        FlushOutput(encoder);
+    }
+
+    return OutputStatus(encoder);
+}
+
+/***************************************************************************
+*   Function   : OutputStatus
+*   Description: This routine reports whether all of the encoder's output
+*                has been written so far.
+*   Parameters : encoder - encoder context to check
+*   Effects    : errno is set to the first output failure, if there was one
+*   Returned   : 0 if there were no output failures, otherwise -1.
+***************************************************************************/
+static int OutputStatus(lzw_encoder_t *encoder)
+{
+    if (0 != encoder->error)
+    {
+        errno = encoder->error;
+        return -1;
+    }
+
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : MakeKey
+*   Description: This routine creates a key from a prefix code and an
+*                appended character.  The key uniquely identifies a string
+*                and is used to locate it in the dictionary hash table.
+*   Parameters : prefixCode - code for all but the last character of a
+*                             string.
+*                suffixChar - the last character of a string
+*   Effects    : None
+*   Returned   : Key built from string represented as a prefix + char.  Key
+*                format is prefix + c.
+***************************************************************************/
+static unsigned int MakeKey(const unsigned int prefixCode,
+    const unsigned char suffixChar)
+{
+    return (prefixCode << CHAR_BIT) | suffixChar;
+}
+
+/***************************************************************************
+*   Function   : MakeDictionary
+*   Description: This routine allocates an empty dictionary.  The pair
+*                table, the hash table and every node the dictionary may
+*                ever hold are carved from a single allocation, so building
+*                the dictionary never calls malloc again.  There is a hash
+*                chain and a node for every code word of maxCodeLen bits.
+*   Parameters : dict - pointer to the dictionary to initialize
+*                maxCodeLen - maximum code word length
+*   Effects    : Memory is allocated for the dictionary
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int MakeDictionary(dictionary_t *dict, const unsigned char maxCodeLen)
+{
+    size_t tableSize;
+
+    /* one chain per code word, so chains average at most one node */
+    dict->hashBits = maxCodeLen;
+
+    /* tables are arrays of slots, nodes follow them */
+    tableSize = (PAIR_TABLE_SIZE + HASH_SIZE(dict)) * sizeof(dict_slot_t);
+    dict->pairTable = calloc(1, tableSize +
+        ((CURRENT_MAX_CODES(maxCodeLen) - FIRST_CODE) * sizeof(dict_node_t)));
+
+    if (NULL == dict->pairTable)
+    {
+        dict->hashTable = NULL;
+        dict->nodes = NULL;
+        return -1;
+    }
+
+    dict->hashTable = dict->pairTable + PAIR_TABLE_SIZE;
+    dict->nodes = (dict_node_t *)((unsigned char *)dict->pairTable +
+        tableSize);
+
+    /* calloc zeroed every slot, so generation 0 is already stale */
+    dict->generation = 0;
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : FreeDictionary
+*   Description: This routine frees a dictionary allocated by
+*                MakeDictionary.
+*   Parameters : dict - pointer to the dictionary to free
+*   Effects    : Memory allocated for the dictionary is freed
+*   Returned   : None
+***************************************************************************/
+static void FreeDictionary(dictionary_t *dict)
+{
+    free(dict->pairTable);
+    dict->pairTable = NULL;
+    dict->hashTable = NULL;
+    dict->nodes = NULL;
+}
+
+/***************************************************************************
+*   Function   : ResetDictionary
+*   Description: This routine empties a dictionary by starting a new
+*                generation.  Slots written in earlier generations are
+*                ignored, and nodes are rewritten as their codes are
+*                reassigned, so nothing needs to be cleared.  The tables
+*                are only cleared when the generation counter wraps.
+*   Parameters : dict - pointer to the dictionary to empty
+*   Effects    : Every string is removed from the dictionary
+*   Returned   : None
+***************************************************************************/
+static void ResetDictionary(dictionary_t *dict)
+{
+    dict->generation++;
+
+    if (0 == dict->generation)
+    {
+        /* counter wrapped, stale slots could look current again */
+        memset(dict->pairTable, 0,
+            (PAIR_TABLE_SIZE + HASH_SIZE(dict)) * sizeof(dict_slot_t));
+        dict->generation = 1;
+    }
+}
+
+/***************************************************************************
+*   Function   : FindDictionaryEntry
+*   Description: This routine searches the encoder's dictionary for an
+*                entry with a matching string (prefix code + suffix
+*                character).  Two character strings are read straight from
+*                the pair table.  Longer strings are checked against the
+*                successor cached in the prefix's node, and only searched
+*                for in the hash table if that misses.
+*   Parameters : encoder - the encoder whose dictionary is searched
+*                prefixCode - code for the prefix of string
+*                c - last character in string
+*   Effects    : A string found in the hash table becomes the successor
+*                cached in its prefix's node.  With LZW_STATS, the search
+*                is counted in the encoder.
+*   Returned   : The code word for the string if it is in the dictionary,
+*                otherwise NO_CODE.
+***************************************************************************/
+static unsigned int FindDictionaryEntry(lzw_encoder_t *encoder,
+    const unsigned int prefixCode, const unsigned char c)
+{
+    dictionary_t *dict;
+    unsigned int code, key, successor;
+    const dict_slot_t *slot;
+
+    dict = &encoder->dictionary;
+    key = MakeKey(prefixCode, c);
+
+    if (prefixCode < FIRST_CODE)
+    {
+        /* prefix is a single character */
+        slot = &dict->pairTable[key];
+        return (slot->generation == dict->generation) ? slot->code : NO_CODE;
+    }
+
+#ifdef LZW_STATS
+    encoder->lookups++;
+#endif
+
+    /* the prefix's node was just used, so this is almost always cached */
+    successor = NODE(dict, prefixCode).successor;
+
+    if ((0 != successor) && ((successor & UCHAR_MAX) == c))
+    {
+#ifdef LZW_STATS
+        encoder->successorHits++;
+#endif
+        return successor >> CHAR_BIT;
+    }
+
+    slot = &dict->hashTable[HASH(dict, key)];
+    code = (slot->generation == dict->generation) ? slot->code : NO_CODE;
+
+    while ((NO_CODE != code) && (NODE(dict, code).key != key))
+    {
+        code = NODE(dict, code).next;
+    }
+
+    if (NO_CODE != code)
+    {
+        NODE(dict, prefixCode).successor = MakeKey(code, c);
+    }
+
+    return code;
+}
+
+/***************************************************************************
+*   Function   : AddDictionaryEntry
+*   Description: This routine adds a string (prefix code + suffix
+*                character) to the dictionary using the node for its code
+*                word.  The string must not already be in the dictionary.
+*   Parameters : dict - the dictionary to add to
+*                code - code word for the new string
+*                prefixCode - code for the prefix of string
+*                c - last character in string
+*   Effects    : The node for code is filled in and either recorded in the
+*                pair table or pushed on the front of its hash chain.
+*                Chain heads from earlier generations are discarded.
+*   Returned   : None
+***************************************************************************/
+static void AddDictionaryEntry(dictionary_t *dict, const unsigned int code,
+    const unsigned int prefixCode, const unsigned char c)
+{
+    unsigned int key;
+    dict_slot_t *slot;
+
+    key = MakeKey(prefixCode, c);
+    NODE(dict, code).key = key;
+    NODE(dict, code).next = NO_CODE;
+    NODE(dict, code).successor = 0;
+
+    if (prefixCode < FIRST_CODE)
+    {
+        /* prefix is a single character */
+        slot = &dict->pairTable[key];
+    }
+    else
+    {
+        /* push node on the front of its chain */
+        slot = &dict->hashTable[HASH(dict, key)];
+
+        if (slot->generation == dict->generation)
+        {
+            NODE(dict, code).next = slot->code;
+        }
+    }
+
+    slot->code = code;
+    slot->generation = dict->generation;
+}
+
+/***************************************************************************
+*   Function   : RemoveDictionaryEntry
+*   Description: This routine removes the string using a code word from
+*                the dictionary so that the code word may be reassigned.
+*   Parameters : dict - the dictionary to remove from
+*                code - code word of the string to remove
+*   Effects    : The string is cleared from the pair table or unlinked from
+*                its hash chain, and dropped from its prefix's successor
+*                cache.
+*   Returned   : The code for the prefix of the removed string
+***************************************************************************/
+static unsigned int RemoveDictionaryEntry(dictionary_t *dict,
+    const unsigned int code)
+{
+    unsigned int key, prefixCode, prev;
+    dict_slot_t *slot;
+
+    key = NODE(dict, code).key;
+    prefixCode = key >> CHAR_BIT;
+
+    if (prefixCode < FIRST_CODE)
+    {
+        /* generation 0 is never current */
+        dict->pairTable[key].generation = 0;
+        return prefixCode;
+    }
+
+    if ((NODE(dict, prefixCode).successor >> CHAR_BIT) == code)
+    {
+        NODE(dict, prefixCode).successor = 0;
+    }
+
+    /* the string is in the dictionary, so its chain head is current */
+    slot = &dict->hashTable[HASH(dict, key)];
+
+    if (slot->code == code)
+    {
+        slot->code = NODE(dict, code).next;
+    }
+    else
+    {
+        prev = slot->code;
+
+        while (NODE(dict, prev).next != code)
+        {
+            prev = NODE(dict, prev).next;
+        }
+
+        NODE(dict, prev).next = NODE(dict, code).next;
+    }
+
+    return prefixCode;
+}
+
+/***************************************************************************
+*   Function   : MakeStandby
+*   Description: This routine allocates a standby dictionary along with the
+*                table mapping active code words to standby code words.
+*   Parameters : standby - pointer to the standby dictionary to initialize
+*                maxCodeLen - maximum code word length
+*   Effects    : Memory is allocated for the standby dictionary
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+static int MakeStandby(standby_t *standby, const unsigned char maxCodeLen)
+{
+    if (0 != MakeDictionary(&standby->dictionary, maxCodeLen))
+    {
+        standby->codes = NULL;
+        return -1;
+    }
+
+    /* code map and stack share an allocation */
+    standby->size = CURRENT_MAX_CODES(maxCodeLen) - FIRST_CODE;
+    standby->codes = malloc(2 * standby->size * sizeof(unsigned int));
+
+    if (NULL == standby->codes)
+    {
+        FreeDictionary(&standby->dictionary);
+        return -1;
+    }
+
+    standby->stack = standby->codes + standby->size;
+    standby->start = STANDBY_START(maxCodeLen);
+    standby->limit = STANDBY_LIMIT(maxCodeLen);
+    ResetStandby(standby);
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : FreeStandby
+*   Description: This routine frees a standby dictionary allocated by
+*                MakeStandby.
+*   Parameters : standby - pointer to the standby dictionary to free
+*   Effects    : Memory allocated for the standby dictionary is freed
+*   Returned   : None
+***************************************************************************/
+static void FreeStandby(standby_t *standby)
+{
+    FreeDictionary(&standby->dictionary);
+    free(standby->codes);
+    standby->codes = NULL;
+    standby->stack = NULL;
+}
+
+/***************************************************************************
+*   Function   : ResetStandby
+*   Description: This routine empties a standby dictionary and stops
+*                copying strings into it.
+*   Parameters : standby - pointer to the standby dictionary to empty
+*   Effects    : Every string is removed from the standby dictionary
+*   Returned   : None
+***************************************************************************/
+static void ResetStandby(standby_t *standby)
+{
+    ResetDictionary(&standby->dictionary);
+    standby->nextCode = FIRST_CODE;
+    standby->priming = 0;
+}
+
+/***************************************************************************
+*   Function   : PrimeStandby
+*   Description: This routine copies a string that was just written from
+*                the active dictionary into the standby dictionary.  Any of
+*                the string's prefixes that aren't in the standby
+*                dictionary are copied first.  Nothing is copied until the
+*                active dictionary reaches STANDBY_START code words, or
+*                after the standby dictionary reaches STANDBY_LIMIT code
+*                words.  The decoder copies the same strings in the same
+*                order.
+*   Parameters : standby - pointer to the standby dictionary
+*                dict - the active dictionary
+*                code - active code word that was just written
+*                nextCode - next available active code word
+*   Effects    : Strings are added to the standby dictionary
+*   Returned   : None
+***************************************************************************/
+static void PrimeStandby(standby_t *standby, const dictionary_t *dict,
+    unsigned int code, const unsigned int nextCode)
+{
+    unsigned int depth, prefixCode;
+
+    if (!standby->priming)
+    {
+        if (nextCode < standby->start)
+        {
+            return;
+        }
+
+        /* no active code word has a standby code word yet */
+        memset(standby->codes, 0, standby->size * sizeof(unsigned int));
+        standby->priming = 1;
+    }
+
+    if (standby->nextCode >= standby->limit)
+    {
+        return;
+    }
+
+    /* walk back to a prefix the standby dictionary already has */
+    depth = 0;
+
+    while ((code >= FIRST_CODE) && (NO_CODE == STANDBY_CODE(standby, code)))
+    {
+        standby->stack[depth] = code;
+        depth++;
+        code = NODE(dict, code).key >> CHAR_BIT;
+    }
+
+    prefixCode = (code < FIRST_CODE) ? code : STANDBY_CODE(standby, code);
+
+    /* copy the missing strings, shortest first */
+    while ((depth > 0) && (standby->nextCode < standby->limit))
+    {
+        depth--;
+        code = standby->stack[depth];
+
+        AddDictionaryEntry(&standby->dictionary, standby->nextCode,
+            prefixCode, NODE(dict, code).key & UCHAR_MAX);
+        STANDBY_CODE(standby, code) = standby->nextCode;
+
+        prefixCode = standby->nextCode;
+        standby->nextCode++;
+    }
+}
+
+/***************************************************************************
+*   Function   : SwitchToStandby
+*   Description: This routine makes the standby dictionary the active
+*                dictionary.  The old active dictionary becomes the new,
+*                empty, standby dictionary.
+*   Parameters : dict - the active dictionary
+*                standby - pointer to the standby dictionary
+*   Effects    : The dictionaries are swapped and the standby is emptied
+*   Returned   : The next available code word in the new active dictionary
+***************************************************************************/
+static unsigned int SwitchToStandby(dictionary_t *dict, standby_t *standby)
+{
+    dictionary_t full;
+    unsigned int nextCode;
+
+    full = *dict;
+    *dict = standby->dictionary;
+    standby->dictionary = full;
+
+    nextCode = standby->nextCode;
+    ResetStandby(standby);
+    return nextCode;
+}
+
+/***************************************************************************
+*   Function   : FillInput
+*   Description: This function reads the next block of a file being
+*                encoded.  Data in memory is all there from the start, so
+*                there is never more of it.
+*   Parameters : encoder - the encoder and its input
+*   Effects    : Up to INPUT_BLOCK bytes are read from fpIn
+*   Returned   : The first byte read, EOF at the end of the input.
+***************************************************************************/
+static int FillInput(lzw_encoder_t *encoder)
+{
+    if (NULL == encoder->fpIn)
+    {
+        return EOF;
+    }
+
+    encoder->inputCount =
+        fread(encoder->inputBlock, 1, INPUT_BLOCK, encoder->fpIn);
+
+    if (0 == encoder->inputCount)
+    {
+        return EOF;
+    }
+
+    encoder->inputNext = 1;
+    return encoder->inputBlock[0];
+}
+
+/***************************************************************************
+*   Function   : PutByte
+*   Description: This function adds a byte of encoded data to the
+*                encoder's output, writing a full output block to its file
+*                first.
+*   Parameters : encoder - the encoder and its output
+*                byte - encoded byte
+*   Effects    : byte is added to the output.  If it doesn't fit, it is
+*                dropped and the failure is recorded for the end of
+*                encoding.
+*   Returned   : None
+***************************************************************************/
+static void PutByte(lzw_encoder_t *encoder, const unsigned char byte)
+{
+    if ((encoder->outputCount == encoder->outputSize) &&
+        (0 != FlushOutput(encoder)))
+    {
+        return;
+    }
+
+    encoder->output[encoder->outputCount] = byte;
+    encoder->outputCount++;
+}
+
+/***************************************************************************
+*   Function   : FlushOutput
+*   Description: This function writes the encoded data in the encoder's
+*                output block to its file, emptying the block.  Memory
+*                being encoded to can't be emptied.
+*   Parameters : encoder - the encoder and its output
+*   Effects    : The output block is written to fpOut.  The first failure
+*                is recorded in the encoder.
+*   Returned   : 0 for success, -1 if the output can't be emptied.
+***************************************************************************/
+static int FlushOutput(lzw_encoder_t *encoder)
+{
+    if (NULL == encoder->fpOut)
+    {
+        /* out of memory to encode to */
+        if (0 == encoder->error)
+        {
+            encoder->error = ENOBUFS;
+        }
+
+        return -1;
+    }
+
+    if ((fwrite(encoder->output, 1, encoder->outputCount, encoder->fpOut) !=
+        encoder->outputCount) && (0 == encoder->error))
+    {
+        encoder->error = (0 != errno) ? errno : EIO;
+    }
+
+    encoder->outputCount = 0;
+    return 0;
 }
 
 /***************************************************************************
 *   Function   : PutCodeWord
-*   Description: This function writes a code word from to an encoded file.
+*   Description: This function writes a code word to the encoder's output.
 *                In order to deal with endian issue the code word is
 *                written least significant byte followed by the remaining
-*                bits.
-*   Parameters : bfpOut - bit file containing the encoded data
+*                bits, the way BitFilePutBitsNum writes it.  The masks and
+*                shifts that does it are only computed when the code word
+*                length changes.  Bits are packed most significant bit
+*                first.
+*   Parameters : encoder - the encoder and its output
 *                code - code word to add to the encoded data
 *                codeLen - length of the code word
-*   Effects    : code word is written to the encoded output
-*   Returned   : EOF for failure, ENOTSUP unsupported architecture,
-*                otherwise the number of bits written.  If an error occurs
-*                after a partial write, the partially written bits will not
-*                be unwritten.
+*   Effects    : code word is written to the encoded output.  Bits that
+*                don't make a whole byte are held until there are enough.
+*   Returned   : None
 ***************************************************************************/
-static int PutCodeWord(bit_file_t *bfpOut, int code,
+static void PutCodeWord(lzw_encoder_t *encoder, const unsigned int code,
     const unsigned char codeLen)
 {
-    return BitFilePutBitsNum(bfpOut, &code, codeLen, sizeof(code));
+    if (codeLen != encoder->orderLen)
+    {
+        /* the code word length changed, so did where its bytes go */
+        SET_CODE_ORDER(encoder->order, codeLen);
+        encoder->orderLen = codeLen;
+    }
+
+    encoder->bits =
+        (encoder->bits << codeLen) | PACK_CODE(encoder->order, code);
+    encoder->bitCount += codeLen;
+
+    while (encoder->bitCount >= CHAR_BIT)
+    {
+        encoder->bitCount -= CHAR_BIT;
+        PutByte(encoder, (encoder->bits >> encoder->bitCount) & UCHAR_MAX);
+    }
+}
+
+/***************************************************************************
+*   Function   : PutClearCode
+*   Description: This function writes a clear code to an encoded file.  The
+*                code word length is first grown to maxCodeLen, since the
+*                clear code only has its meaning at that length.
+*   Parameters : encoder - the encoder and its output
+*                codeLen - pointer to the current code word length
+*                maxCodeLen - maximum code word length
+*   Effects    : The clear code, preceded by any code word length increase
+*                markers, is written to the encoded output.  *codeLen is
+*                set to maxCodeLen.
+*   Returned   : None
+***************************************************************************/
+static void PutClearCode(lzw_encoder_t *encoder, unsigned char *codeLen,
+    const unsigned char maxCodeLen)
+{
+    while (*codeLen < maxCodeLen)
+    {
+        PutCodeWord(encoder, GROW_CODE(*codeLen), *codeLen);
+        (*codeLen)++;
+    }
+
+    PutCodeWord(encoder, CLEAR_CODE(maxCodeLen), *codeLen);
+}
+
+/***************************************************************************
+*   Function   : EncodeFrozen
+*   Description: This routine encodes input with the full dictionary of the
+*                LZW_FULL_FREEZE policy.  A frozen dictionary is only read
+*                from, so this loop does nothing but look strings up and
+*                write code words at the maximum length.  A string that
+*                isn't in the dictionary once the ratio window is full is
+*                left for the caller, which writes it and decides whether
+*                to clear the dictionary, exactly as it would have if it
+*                had read the input itself.  Where the input is split into
+*                pieces doesn't change where the ratio is checked.
+*   Parameters : encoder - encoder with the full dictionary, its input and
+*                          its output
+*                code - pointer to the code for the current string
+*                codeLen - length of code words (the maximum)
+*                windowIn - pointer to bytes read in the ratio window
+*                windowOut - pointer to bits written in the ratio window
+*   Effects    : Input is encoded until it ends or a string must be
+*                written with *windowIn reaching RATIO_WINDOW.  The byte
+*                that ended that string is put back.  *code is left
+*                holding the code for the string that hasn't been written
+*                yet.
+*   Returned   : EOF if the input ended, otherwise 0.
+***************************************************************************/
+static int EncodeFrozen(lzw_encoder_t *encoder, unsigned int *code,
+    const unsigned char codeLen, unsigned long *windowIn,
+    unsigned long *windowOut)
+{
+    unsigned int current, entry;
+    unsigned long in, out;
+    int c;
+
+    current = *code;
+    in = *windowIn;
+    out = *windowOut;
+
+    while (EOF != (c = GET_CHAR(encoder)))
+    {
+        entry = FindDictionaryEntry(encoder, current, c);
+
+        if (NO_CODE != entry)
+        {
+            in++;
+            current = entry;
+        }
+        else if ((in + 1) < RATIO_WINDOW)
+        {
+            in++;
+            PutCodeWord(encoder, current, codeLen);
+            out += codeLen;
+            current = c;
+        }
+        else
+        {
+            /* the caller writes current and checks the ratio */
+            UNGET_CHAR(encoder);
+            break;
+        }
+    }
+
+    *code = current;
+    *windowIn = in;
+    *windowOut = out;
+    return (EOF == c) ? EOF : 0;
 }
@@ -37,27 +37,168 @@
 ***************************************************************************/
 #include <stdio.h>
 #include <limits.h>
+#include "lzw.h"
 
 /***************************************************************************
 *                                CONSTANTS
 ***************************************************************************/
-#define MIN_CODE_LEN    9                   /* min # bits in a code word */
-#define MAX_CODE_LEN    20                  /* max # bits in a code word */
+#define MIN_CODE_LEN    LZW_MIN_CODE_LEN    /* min # bits in a code word */
+#define MAX_CODE_LEN    LZW_MAX_CODE_LEN    /* max # bits in any code word */
 
 #define FIRST_CODE      (1 << CHAR_BIT)     /* value of 1st string code */
-#define MAX_CODES       (1 << MAX_CODE_LEN)
+
+/* follows a clear code when the encoder switched to its standby dictionary */
+#define SWITCH_CODE     FIRST_CODE
+
+/***************************************************************************
+* Encoded data starts with a header byte.  Its low HEADER_LEN_BITS bits
+* hold the maximum code word length, and the remaining bits hold the
+* lzw_full_policy_t the encoder followed when its dictionary was full.
+***************************************************************************/
+#define HEADER_LEN_BITS 5
+#define HEADER_LEN_MASK ((1 << HEADER_LEN_BITS) - 1)
 
 #if (MIN_CODE_LEN <= CHAR_BIT)
 #error Code words must be larger than 1 character
 #endif
 
-#if ((MAX_CODES - 1) > INT_MAX)
+#if (((1L << MAX_CODE_LEN) - 1) > INT_MAX)
 #error There cannot be more codes than can fit in an integer
 #endif
 
+#if (LZW_DEFAULT_CODE_LEN < MIN_CODE_LEN) || \
+    (LZW_DEFAULT_CODE_LEN > MAX_CODE_LEN)
+#error Default maximum code word length is out of range
+#endif
+
+#if (MAX_CODE_LEN > HEADER_LEN_MASK)
+#error Maximum code word length must fit in the header
+#endif
+
+/* a code word is packed as up to CODE_FIELDS groups of bits, see below */
+#define CODE_FIELDS     3
+
+#if (MAX_CODE_LEN > (CODE_FIELDS * CHAR_BIT))
+#error Code words must fit in CODE_FIELDS bytes
+#endif
+
 /***************************************************************************
 *                                  MACROS
 ***************************************************************************/
 #define CURRENT_MAX_CODES(bits)     ((unsigned int)(1 << (bits)))
 
+/***************************************************************************
+* Code words of codeLen bits from GROW_CODE(codeLen) up need a longer code
+* word.  It changes only when the code word length does, so the encoder and
+* decoder keep it in a local and test each code word with one comparison.
+* At the maximum length it equals the clear code, which no string is ever
+* assigned, so the encoder never grows code words past the maximum.
+***************************************************************************/
+#define GROW_CODE(codeLen)          (CURRENT_MAX_CODES(codeLen) - 1)
+
+/***************************************************************************
+* A code word of all ones means "code words grow by a bit" until they reach
+* the stream's maximum length.  They can't grow any further, so at the
+* maximum length all ones means the encoder's dictionary was full and has
+* been emptied.  It can never be assigned to a string.  The first code
+* word after a clear is MIN_CODE_LEN bits long.  It is normally a
+* character, but SWITCH_CODE means that instead of being emptied, the
+* dictionary was replaced by the standby dictionary (LZW_FULL_STANDBY).
+***************************************************************************/
+#define CLEAR_CODE(maxCodeLen)      (CURRENT_MAX_CODES(maxCodeLen) - 1)
+
+/***************************************************************************
+* With the LZW_FULL_STANDBY policy, strings written once the dictionary is
+* half full are also added to the standby dictionary.  The standby
+* dictionary stops growing when it is half full, leaving it room to learn
+* after it becomes the active dictionary.
+***************************************************************************/
+#define STANDBY_START(maxCodeLen)   \
+    (FIRST_CODE + ((CLEAR_CODE(maxCodeLen) - FIRST_CODE) / 2))
+#define STANDBY_LIMIT(maxCodeLen)   \
+    (FIRST_CODE + ((CLEAR_CODE(maxCodeLen) - FIRST_CODE) / 2))
+
+#define MAKE_HEADER(codeLen, policy)    \
+    ((((unsigned int)(policy)) << HEADER_LEN_BITS) | (codeLen))
+
+/***************************************************************************
+* Code words are packed a whole byte at a time, least significant byte
+* first, followed by the remaining high bits, the way BitFilePutBitsNum
+* wrote them.  For a given code word length, field k of a code word (its
+* k-th byte, or the remaining bits) always moves from bit CHAR_BIT * k of
+* the code word to bit FIELD_SHIFT(codeLen, k) of the packed bits.  The
+* encoder and decoder compute a code_order_t when the code word length
+* changes, then pack and unpack code words with fixed masks and shifts.
+***************************************************************************/
+#define BITS_AFTER(codeLen, k)  ((int)(codeLen) - (CHAR_BIT * (k)))
+
+#define FIELD_MASK(codeLen, k)  \
+    ((BITS_AFTER(codeLen, k) >= CHAR_BIT) ? UCHAR_MAX : \
+    (BITS_AFTER(codeLen, k) > 0) ? ((1U << BITS_AFTER(codeLen, k)) - 1) : 0)
+
+#define FIELD_SHIFT(codeLen, k) \
+    ((BITS_AFTER(codeLen, k) >= CHAR_BIT) ? \
+    (BITS_AFTER(codeLen, k) - CHAR_BIT) : 0)
+
+#define SET_CODE_ORDER(order, codeLen)  \
+    do \
+    { \
+        (order).mask[0] = FIELD_MASK(codeLen, 0); \
+        (order).shift[0] = FIELD_SHIFT(codeLen, 0); \
+        (order).mask[1] = FIELD_MASK(codeLen, 1); \
+        (order).shift[1] = FIELD_SHIFT(codeLen, 1); \
+        (order).mask[2] = FIELD_MASK(codeLen, 2); \
+        (order).shift[2] = FIELD_SHIFT(codeLen, 2); \
+    } while (0)
+
+/* code word's bits in the order they are written */
+#define PACK_CODE(order, code)  \
+    ((((code) & (order).mask[0]) << (order).shift[0]) | \
+    ((((code) >> CHAR_BIT) & (order).mask[1]) << (order).shift[1]) | \
+    ((((code) >> (2 * CHAR_BIT)) & (order).mask[2]) << (order).shift[2]))
+
+/* code word from its bits in the order they were read */
+#define UNPACK_CODE(order, value)   \
+    ((((value) >> (order).shift[0]) & (order).mask[0]) | \
+    ((((value) >> (order).shift[1]) & (order).mask[1]) << CHAR_BIT) | \
+    ((((value) >> (order).shift[2]) & (order).mask[2]) << (2 * CHAR_BIT)))
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* where each field of a code word goes, for one code word length */
+typedef struct
+{
+    unsigned int mask[CODE_FIELDS];     /* field's bits, once shifted down */
+    unsigned char shift[CODE_FIELDS];   /* field's position when packed */
+} code_order_t;
+
+/* code word use tracked for the LZW_FULL_LRU policy */
+typedef struct
+{
+    unsigned short children;    /* number of strings extending this one */
+    unsigned char referenced;   /* used since the clock hand last passed */
+} lru_code_t;
+
+typedef struct
+{
+    lru_code_t *codes;          /* indexed by (code word - FIRST_CODE) */
+    unsigned int hand;          /* next code word the clock examines */
+    unsigned int leaves;        /* strings that don't prefix others */
+    unsigned int clearCode;     /* first code word that isn't a string */
+} lru_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* least recently used code word tracking (lzwlru.c) */
+int MakeLRU(lru_t *lru, const unsigned char maxCodeLen);
+void FreeLRU(lru_t *lru);
+void ResetLRU(lru_t *lru);
+void LRUAddCode(lru_t *lru, const unsigned int code,
+    const unsigned int prefixCode);
+void LRURemoveCode(lru_t *lru, const unsigned int prefixCode);
+void LRUUseCode(lru_t *lru, const unsigned int code);
+unsigned int LRUFindVictim(lru_t *lru, const unsigned int exclude);
+
 #endif  /* ndef _LZWLOCAL_H_ */
@@ -0,0 +1,238 @@
+/***************************************************************************
+*           Lempel-Ziv-Welch Least Recently Used Code Word Tracking
+*
+*   File    : lzwlru.c
+*   Purpose : Provides functions that select the least recently used code
+*             word to replace when a full dictionary uses the LRU policy.
+*             The encoder and decoder must make identical choices, so both
+*             use these functions.
+*   Author  : agent
+*   Date    : October 17, 2026
+*
+****************************************************************************
+*
+* LZW: An ANSI C Lempel-Ziv-Welch Encoding/Decoding Routines
+* Copyright (C) 2026 by
+* agent (agent@local)
+*
+* This file is part of the lzw library.
+*
+* The lzw library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The lzw library is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "lzwlocal.h"
+
+/***************************************************************************
+*                                  MACROS
+***************************************************************************/
+/* LRU data for a string code word */
+#define LRU_CODE(lru, code)     ((lru)->codes[(code) - FIRST_CODE])
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/***************************************************************************
+*   Function   : MakeLRU
+*   Description: This routine allocates the data used to track code word
+*                use for every string code word.
+*   Parameters : lru - pointer to the LRU data to initialize
+*                maxCodeLen - maximum code word length in the stream
+*   Effects    : Memory is allocated for the LRU data
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+***************************************************************************/
+int MakeLRU(lru_t *lru, const unsigned char maxCodeLen)
+{
+    lru->clearCode = CLEAR_CODE(maxCodeLen);
+    lru->codes = malloc((lru->clearCode - FIRST_CODE) * sizeof(lru_code_t));
+
+    if (NULL == lru->codes)
+    {
+        return -1;
+    }
+
+    ResetLRU(lru);
+    return 0;
+}
+
+/***************************************************************************
+*   Function   : FreeLRU
+*   Description: This routine frees LRU data allocated by MakeLRU.
+*   Parameters : lru - pointer to the LRU data to free
+*   Effects    : Memory allocated for the LRU data is freed
+*   Returned   : None
+***************************************************************************/
+void FreeLRU(lru_t *lru)
+{
+    free(lru->codes);
+    lru->codes = NULL;
+}
+
+/***************************************************************************
+*   Function   : ResetLRU
+*   Description: This routine prepares the LRU data for an empty
+*                dictionary.  Data for each code word is initialized when
+*                the code word is added, so only the clock hand and leaf
+*                count are reset.
+*   Parameters : lru - pointer to the LRU data to reset
+*   Effects    : The clock hand is moved back to the first string code
+*   Returned   : None
+***************************************************************************/
+void ResetLRU(lru_t *lru)
+{
+    lru->hand = FIRST_CODE;
+    lru->leaves = 0;
+}
+
+/***************************************************************************
+*   Function   : LRUAddCode
+*   Description: This routine records a code word that was just assigned
+*                to a string.  The new code word has no extensions and
+*                hasn't been used yet.  Its prefix gains an extension.
+*   Parameters : lru - pointer to the LRU data
+*                code - code word assigned to the string
+*                prefixCode - code for all but the last character of the
+*                             string
+*   Effects    : The LRU data for code and prefixCode is updated
+*   Returned   : None
+***************************************************************************/
+void LRUAddCode(lru_t *lru, const unsigned int code,
+    const unsigned int prefixCode)
+{
+    LRU_CODE(lru, code).children = 0;
+    LRU_CODE(lru, code).referenced = 0;
+    lru->leaves++;
+
+    if (prefixCode >= FIRST_CODE)
+    {
+        if (0 == LRU_CODE(lru, prefixCode).children)
+        {
+            lru->leaves--;
+        }
+
+        LRU_CODE(lru, prefixCode).children++;
+    }
+}
+
+/***************************************************************************
+*   Function   : LRURemoveCode
+*   Description: This routine records that a code word was taken away from
+*                its string.  The string must not have been the prefix of
+*                another string.  The string's prefix loses an extension.
+*   Parameters : lru - pointer to the LRU data
+*                prefixCode - prefix code of the string that was removed
+*   Effects    : The LRU data for prefixCode is updated
+*   Returned   : None
+***************************************************************************/
+void LRURemoveCode(lru_t *lru, const unsigned int prefixCode)
+{
+    lru->leaves--;
+
+    if (prefixCode >= FIRST_CODE)
+    {
+        LRU_CODE(lru, prefixCode).children--;
+
+        if (0 == LRU_CODE(lru, prefixCode).children)
+        {
+            lru->leaves++;
+        }
+    }
+}
+
+/***************************************************************************
+*   Function   : LRUUseCode
+*   Description: This routine records that a code word was written to (or
+*                read from) the encoded stream.
+*   Parameters : lru - pointer to the LRU data
+*                code - code word that was used
+*   Effects    : code is marked as referenced
+*   Returned   : None
+***************************************************************************/
+void LRUUseCode(lru_t *lru, const unsigned int code)
+{
+    if (code >= FIRST_CODE)
+    {
+        LRU_CODE(lru, code).referenced = 1;
+    }
+}
+
+/***************************************************************************
+*   Function   : LRUFindVictim
+*   Description: This routine uses the clock algorithm to approximate the
+*                least recently used code word in a full dictionary.  The
+*                hand sweeps the string code words, giving referenced code
+*                words a second chance.  Only strings that aren't the
+*                prefix of another string may be replaced, otherwise
+*                strings built on them could no longer be decoded.  If
+*                every string is a prefix of another one, except for
+*                exclude, nothing may be replaced.  That happens when a
+*                long run of one character fills the dictionary with a
+*                single chain of strings.
+*   Parameters : lru - pointer to the LRU data
+*                exclude - code word that must not be chosen (the prefix of
+*                          the string about to be added)
+*   Effects    : The clock hand advances and referenced bits it passes are
+*                cleared
+*   Returned   : The code word to replace, or the clear code if no code
+*                word may be replaced.
+***************************************************************************/
+unsigned int LRUFindVictim(lru_t *lru, const unsigned int exclude)
+{
+    unsigned int code;
+
+    code = lru->leaves;
+
+    if ((exclude >= FIRST_CODE) && (0 == LRU_CODE(lru, exclude).children))
+    {
+        code--;     /* exclude is a leaf, but it can't be used */
+    }
+
+    if (0 == code)
+    {
+        return lru->clearCode;
+    }
+
+    while (1)
+    {
+        code = lru->hand;
+        lru->hand++;
+
+        if (lru->clearCode == lru->hand)
+        {
+            lru->hand = FIRST_CODE;
+        }
+
+        if ((0 != LRU_CODE(lru, code).children) || (exclude == code))
+        {
+            /* other strings depend on this one */
+            continue;
+        }
+
+        if (LRU_CODE(lru, code).referenced)
+        {
+            /* used since the hand last passed, give it another chance */
+            LRU_CODE(lru, code).referenced = 0;
+            continue;
+        }
+
+        return code;
+    }
+}
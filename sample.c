@@ -42,6 +42,8 @@
 /***************************************************************************
 *                               PROTOTYPES
 ***************************************************************************/
+static int EncodeFile(FILE *fpIn, FILE *fpOut, const unsigned int codeLen,
+    const unsigned int threshold, const lzw_full_policy_t policy);
 
 /***************************************************************************
 *                                FUNCTIONS
@@ -66,14 +68,20 @@ int main(int argc, char *argv[])
     FILE *fpIn;             /* pointer to open input file */
     FILE *fpOut;            /* pointer to open output file */
     char encode;            /* encode/decode */
+    unsigned int codeLen;   /* maximum code word length */
+    unsigned int threshold; /* dictionary reset threshold */
+    lzw_full_policy_t policy;   /* what to do when dictionary is full */
 
     /* initialize data */
     fpIn = stdin;
     fpOut = stdout;
     encode = 1;
+    codeLen = LZW_DEFAULT_CODE_LEN;
+    threshold = 0;
+    policy = LZW_FULL_RESET;
 
     /* parse command line */
-    optList = GetOptList(argc, argv, "cdi:o:h?");
+    optList = GetOptList(argc, argv, "cdi:o:b:r:f:h?");
     thisOpt = optList;
 
     while (thisOpt != NULL)
@@ -151,6 +159,51 @@ int main(int argc, char *argv[])
                 }
                 break;
 
+            case 'b':       /* maximum code word length */
+                codeLen = atoi(thisOpt->argument);
+                break;
+
+            case 'r':       /* dictionary reset threshold */
+                threshold = atoi(thisOpt->argument);
+                break;
+
+            case 'f':       /* full dictionary policy */
+                if (0 == strcmp(thisOpt->argument, "reset"))
+                {
+                    policy = LZW_FULL_RESET;
+                }
+                else if (0 == strcmp(thisOpt->argument, "lru"))
+                {
+                    policy = LZW_FULL_LRU;
+                }
+                else if (0 == strcmp(thisOpt->argument, "standby"))
+                {
+                    policy = LZW_FULL_STANDBY;
+                }
+                else if (0 == strcmp(thisOpt->argument, "freeze"))
+                {
+                    policy = LZW_FULL_FREEZE;
+                }
+                else
+                {
+                    fprintf(stderr, "Unknown full dictionary policy.\n");
+
+                    if (fpIn != stdin)
+                    {
+                        fclose(fpIn);
+                    }
+
+                    if (fpOut != stdout)
+                    {
+                        fclose(fpOut);
+                    }
+
+                    FreeOptList(optList);
+                    errno = EINVAL;
+                    return -1;
+                }
+                break;
+
             case 'h':
             case '?':
                 printf("Usage: %s <options>\n\n", FindFileName(argv[0]));
@@ -159,6 +212,16 @@ int main(int argc, char *argv[])
                 printf("  -d : Decode input file to output file.\n");
                 printf("  -i <filename> : Name of input file.\n");
                 printf("  -o <filename> : Name of output file.\n");
+                printf("  -b <bits> : Maximum code word length (%d - %d, "
+                    "default %d).\n", LZW_MIN_CODE_LEN, LZW_MAX_CODE_LEN,
+                    LZW_DEFAULT_CODE_LEN);
+                printf("  -r <percent> : Reset dictionary when output exceeds "
+                    "percent of input.\n");
+                printf("  -f <reset | lru | standby | freeze> : When "
+                    "dictionary is full, reset\n");
+                printf("       it, recycle least recently used code words, "
+                    "switch to a standby\n");
+                printf("       dictionary, or stop adding to it.\n");
                 printf("  -h | ?  : Print out command line options.\n\n");
                 printf("Default: %s -c -i stdin -o stdout\n",
                     FindFileName(argv[0]));
@@ -175,14 +238,62 @@ int main(int argc, char *argv[])
     /* parsed the parameters.  now encode or decode. */
     if (encode)
     {
-        LZWEncodeFile(fpIn, fpOut);
+        EncodeFile(fpIn, fpOut, codeLen, threshold, policy);
     }
     else
     {
         LZWDecodeFile(fpIn, fpOut);
     }
 
-    free(fpIn);
-    free(fpOut);
+    fclose(fpIn);
+    fclose(fpOut);
     return 0;
 }
+
+/****************************************************************************
+*   Function   : EncodeFile
+*   Description: This function creates an encoder with the requested
+*                maximum code word length, dictionary reset threshold, and
+*                full dictionary policy and uses it to encode a file.
+*   Parameters : fpIn - pointer to the open binary file to encode
+*                fpOut - pointer to the open binary file to write encoded
+*                        output
+*                codeLen - maximum code word length
+*                threshold - dictionary reset threshold (0 to disable)
+*                policy - what to do when the dictionary is full
+*   Effects    : fpIn is encoded and written to fpOut
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int EncodeFile(FILE *fpIn, FILE *fpOut, const unsigned int codeLen,
+    const unsigned int threshold, const lzw_full_policy_t policy)
+{
+    lzw_encoder_t *encoder;
+    int result;
+
+    encoder = LZWCreateEncoder(codeLen);
+
+    if (NULL == encoder)
+    {
+        perror("Creating encoder");
+        return -1;
+    }
+
+    result = LZWEncoderSetResetThreshold(encoder, threshold);
+
+    if (0 != result)
+    {
+        perror("Setting reset threshold");
+    }
+    else if (0 != (result = LZWEncoderSetFullPolicy(encoder, policy)))
+    {
+        perror("Setting full dictionary policy");
+    }
+    else
+    {
+        result = LZWEncoderEncodeFile(encoder, fpIn, fpOut);
+    }
+
+    LZWDestroyEncoder(encoder);
+    return result;
+}